@@ -0,0 +1,139 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da afinidade das tarefas com as trabalhadoras de task_offload, com
+// duas trabalhadoras. Uma tarefa presa à trabalhadora 1 (task_set_affinity)
+// confere com task_get_cpu que todos os seus trabalhos executaram nela; outra,
+// com uma máscara que não inclui nenhuma trabalhadora existente, precisa
+// terminar (a máscara vale como todas). Duas tarefas que se comunicam pelo
+// mesmo semáforo devem ter os trabalhos executados na mesma trabalhadora.
+// Por fim, enquanto um trabalho preso à trabalhadora 1 dorme ESPERA ms, a
+// trabalhadora 0 não pode ficar girando: mede o tempo de processador do
+// processo nesse intervalo.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ppos.h"
+#include "ppos-core-globals.h"
+
+#define TRABALHOS 20
+#define ESPERA    300   // ms
+
+task_t presa, semDona, parceira[2] ;
+semaphore_t s ;
+int foraDaUm, cpuParceira[2], migracoesParceira[2] ;
+
+// trabalho curto (executado pelas trabalhadoras)
+void soma (void * arg)
+{
+   volatile long *total = arg ;
+   int i ;
+
+   for (i=0; i<100000; i++)
+      (*total) += i ;
+}
+
+// trabalho que só espera (executado pelas trabalhadoras)
+void dorme (void * arg)
+{
+   struct timespec t = { 0, ESPERA * 1000000L } ;
+
+   nanosleep (&t, NULL) ;
+}
+
+// tempo do relógio indicado, em ms
+double relogio (clockid_t qual)
+{
+   struct timespec ts ;
+
+   clock_gettime (qual, &ts) ;
+   return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0 ;
+}
+
+void Presa (void * arg)
+{
+   long total = 0 ;
+   int i ;
+
+   task_set_affinity (NULL, 1UL << 1) ;
+   for (i=0; i<TRABALHOS; i++)
+   {
+      task_offload (soma, &total) ;
+      if (task_get_cpu (NULL) != 1)
+         foraDaUm++ ;
+   }
+   task_exit (0) ;
+}
+
+void SemDona (void * arg)
+{
+   long total = 0 ;
+   int i ;
+
+   task_set_affinity (NULL, 1UL << 10) ;
+   for (i=0; i<TRABALHOS; i++)
+      task_offload (soma, &total) ;
+   task_exit (0) ;
+}
+
+void Parceira (void * arg)
+{
+   long id = (long) arg, total = 0 ;
+   int i ;
+
+   for (i=0; i<TRABALHOS; i++)
+   {
+      sem_down (&s) ;
+      task_offload (soma, &total) ;
+      sem_up (&s) ;
+      task_yield () ;
+   }
+   cpuParceira[id] = task_get_cpu (NULL) ;
+   migracoesParceira[id] = taskExec->migracoes ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   double parede, processador ;
+   long i ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+   ppos_set_workers (2) ;
+
+   printf ("main: task_get_cpu antes de qualquer trabalho: %d\n", task_get_cpu (NULL)) ;
+
+   task_create (&presa, Presa, NULL) ;
+   task_create (&semDona, SemDona, NULL) ;
+   task_join (&presa) ;
+   printf ("main: tarefa presa a trabalhadora 1: %d trabalhos fora dela\n", foraDaUm) ;
+   task_join (&semDona) ;
+   printf ("main: tarefa com mascara sem trabalhadoras terminou\n") ;
+
+   sem_create (&s, 1) ;
+   for (i=0; i<2; i++)
+      task_create (&parceira[i], Parceira, (void *) i) ;
+   for (i=0; i<2; i++)
+      task_join (&parceira[i]) ;
+   sem_destroy (&s) ;
+   printf ("main: parceiras nas trabalhadoras %d e %d, %d e %d migracoes\n",
+           cpuParceira[0], cpuParceira[1], migracoesParceira[0], migracoesParceira[1]) ;
+
+   task_set_affinity (NULL, 1UL << 1) ;
+   parede = relogio (CLOCK_MONOTONIC) ;
+   processador = relogio (CLOCK_PROCESS_CPUTIME_ID) ;
+   task_offload (dorme, NULL) ;
+   parede = relogio (CLOCK_MONOTONIC) - parede ;
+   processador = relogio (CLOCK_PROCESS_CPUTIME_ID) - processador ;
+   printf ("main: %.0f ms de processador em %.0f ms de espera\n", processador, parede) ;
+
+   if (foraDaUm == 0 && cpuParceira[0] == cpuParceira[1] && migracoesParceira[0] + migracoesParceira[1] == 0
+       && processador < parede / 2)
+      printf ("main: afinidade respeitada, parceiras juntas e trabalhadoras ociosas dormindo, correto!\n") ;
+
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+   exit (0) ;
+}
@@ -0,0 +1,216 @@
+// PingPongOS - PingPong Operating System
+
+// Teste das variáveis de condição. Primeiro, produtores e consumidores num
+// buffer limitado, com as condições "há item" e "há vaga" (cond_signal);
+// confere que todos os itens produzidos foram consumidos. Depois, o
+// cond_broadcast: NUMESPERA tarefas esperam a próxima rodada e a tarefa
+// main anuncia RODADAS rodadas, cada uma com um broadcast feito com o mutex
+// obtido, que ela ainda segura por POSSE ms. Compara com um broadcast
+// ingênuo, que acorda todas as tarefas (um semáforo por tarefa) para que
+// voltem a obter o mutex: as acordadas entram no processador com o mutex
+// ainda ocupado e voltam a esperar, agora na fila dele. Informa as
+// ativações das tarefas por rodada (uma só por tarefa é o mínimo). Por fim,
+// dois cond_timedwait (de 0 e de 50 ms) que esgotam o prazo e voltam com o
+// mutex.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+#include "ppos-core-globals.h"
+
+#define NUMPROD   3
+#define NUMCONS   2
+#define ITENS     200
+#define TAMBUFFER 5
+#define NUMESPERA 8
+#define RODADAS   20
+#define POSSE     30    // ms com o mutex depois do broadcast
+
+task_t produtor[NUMPROD], consumidor[NUMCONS], espera[NUMESPERA] ;
+mutex_t m ;
+cond_t temItem, temVaga, novaRodada, todasViram ;
+semaphore_t acorda[NUMESPERA] ;
+int buffer[TAMBUFFER], inicioBuffer, itensBuffer ;
+long produzidos, consumidos ;
+int consumidosTotal ;
+int rodada, viram, ingenuo ;
+
+// usa o processador por t ms
+void gasta (int t)
+{
+   int fim = systime () + t ;
+
+   while (systime () < fim) ;
+}
+
+void Produtor (void * arg)
+{
+   int i, item ;
+
+   for (i=0; i<ITENS; i++)
+   {
+      item = (long) arg * ITENS + i ;
+      mutex_lock (&m) ;
+      while (itensBuffer == TAMBUFFER)
+         cond_wait (&temVaga, &m) ;
+      buffer[(inicioBuffer + itensBuffer) % TAMBUFFER] = item ;
+      itensBuffer++ ;
+      produzidos += item ;
+      cond_signal (&temItem) ;
+      mutex_unlock (&m) ;
+   }
+   task_exit (0) ;
+}
+
+void Consumidor (void * arg)
+{
+   int item ;
+
+   for (;;)
+   {
+      mutex_lock (&m) ;
+      while (itensBuffer == 0 && consumidosTotal < NUMPROD * ITENS)
+         cond_wait (&temItem, &m) ;
+      if (itensBuffer == 0)
+      {
+         mutex_unlock (&m) ;
+         break ;
+      }
+      item = buffer[inicioBuffer] ;
+      inicioBuffer = (inicioBuffer + 1) % TAMBUFFER ;
+      itensBuffer-- ;
+      consumidos += item ;
+      consumidosTotal++ ;
+      // o último item libera os consumidores que ainda esperam
+      if (consumidosTotal == NUMPROD * ITENS)
+         cond_broadcast (&temItem) ;
+      cond_signal (&temVaga) ;
+      mutex_unlock (&m) ;
+   }
+   task_exit (0) ;
+}
+
+// espera cada rodada anunciada pela main e avisa que a viu
+void Espera (void * arg)
+{
+   long id = (long) arg ;
+   int vista = 0 ;
+
+   mutex_lock (&m) ;
+   while (vista < RODADAS)
+   {
+      while (rodada == vista)
+      {
+         if (ingenuo)
+         {
+            mutex_unlock (&m) ;
+            sem_down (&acorda[id]) ;
+            mutex_lock (&m) ;
+         }
+         else
+            cond_wait (&novaRodada, &m) ;
+      }
+      vista = rodada ;
+      if (++viram == NUMESPERA)
+         cond_signal (&todasViram) ;
+   }
+   mutex_unlock (&m) ;
+   task_exit (0) ;
+}
+
+void mede (int modo)
+{
+   int i, r, ativacoes = 0 ;
+
+   ingenuo = modo ;
+   rodada = 0 ;
+   for (i=0; i<NUMESPERA; i++)
+   {
+      sem_create (&acorda[i], 0) ;
+      task_create (&espera[i], Espera, (void *) (long) i) ;
+   }
+   // dá às tarefas a chance de passarem a esperar a primeira rodada
+   task_yield () ;
+
+   for (r=1; r<=RODADAS; r++)
+   {
+      mutex_lock (&m) ;
+      rodada = r ;
+      viram = 0 ;
+      if (ingenuo)
+         for (i=0; i<NUMESPERA; i++)
+            sem_up (&acorda[i]) ;
+      else
+         cond_broadcast (&novaRodada) ;
+      gasta (POSSE) ;
+      while (viram < NUMESPERA)
+         cond_wait (&todasViram, &m) ;
+      mutex_unlock (&m) ;
+   }
+
+   for (i=0; i<NUMESPERA; i++)
+   {
+      task_join (&espera[i]) ;
+      ativacoes += espera[i].ativacoes ;
+      sem_destroy (&acorda[i]) ;
+   }
+
+   printf ("broadcast %-7s: %.2f ativacoes por tarefa por rodada\n",
+           ingenuo ? "ingenuo" : "cond", (double) ativacoes / (NUMESPERA * RODADAS)) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i, inicio, r ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   mutex_create (&m) ;
+   cond_create (&temItem) ;
+   cond_create (&temVaga) ;
+   cond_create (&novaRodada) ;
+   cond_create (&todasViram) ;
+
+   for (i=0; i<NUMPROD; i++)
+      task_create (&produtor[i], Produtor, (void *) (long) i) ;
+   for (i=0; i<NUMCONS; i++)
+      task_create (&consumidor[i], Consumidor, NULL) ;
+   for (i=0; i<NUMPROD; i++)
+      task_join (&produtor[i]) ;
+   for (i=0; i<NUMCONS; i++)
+      task_join (&consumidor[i]) ;
+
+   if (produzidos == consumidos && consumidosTotal == NUMPROD * ITENS)
+      printf ("main: %d itens consumidos, soma %ld, valor correto!\n", consumidosTotal, consumidos) ;
+   else
+      printf ("main: %d itens consumidos, soma %ld, mas deveria ser %ld!\n",
+              consumidosTotal, consumidos, produzidos) ;
+   printf ("main: %d sinais em temItem, %d em temVaga\n", temItem.sinais, temVaga.sinais) ;
+
+   mede (1) ;
+   mede (0) ;
+
+   // ninguém sinaliza: o prazo esgota e cond_timedwait volta com o mutex
+   // (com prazo nulo, na hora)
+   mutex_lock (&m) ;
+   r = cond_timedwait (&todasViram, &m, 0) ;
+   printf ("main: cond_timedwait de 0 ms: %d (%s o mutex)\n",
+           r, m.dono == taskExec ? "com" : "sem") ;
+   inicio = systime () ;
+   r = cond_timedwait (&todasViram, &m, 50) ;
+   printf ("main: cond_timedwait de 50 ms sem sinal: %d (apos %d ms, %s o mutex)\n",
+           r, systime () - inicio, m.dono == taskExec ? "com" : "sem") ;
+   mutex_unlock (&m) ;
+
+   cond_destroy (&temItem) ;
+   cond_destroy (&temVaga) ;
+   cond_destroy (&novaRodada) ;
+   cond_destroy (&todasViram) ;
+   mutex_destroy (&m) ;
+
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+   exit (0) ;
+}
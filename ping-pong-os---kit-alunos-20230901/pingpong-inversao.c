@@ -0,0 +1,158 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da herança de prioridade dos mutexes sob o SRTF. Uma tarefa longa
+// (tempo restante grande) obtém um mutex e, ainda com ele, cria uma tarefa
+// curta que precisa do mesmo mutex e NUMMEDIAS tarefas médias, que só usam o
+// processador. Sem herança a tarefa curta espera o mutex atrás das médias,
+// que o SRTF prefere à longa (inversão de prioridade); com herança a longa
+// herda a chave da curta e libera o mutex logo. Na versão encadeada a longa
+// espera ainda um segundo mutex, de uma tarefa mais longa, que herda a chave
+// da curta através dela. Informa a espera da tarefa curta em cada rodada.
+// Uso: pingpong-inversao [0|1]   (herança desligada ou ligada, o padrão)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+#include "ppos-core-globals.h"
+
+#define NUMMEDIAS 3
+#define RODADAS   3
+#define POSSE     40    // ms de processador da longa com o mutex
+#define MEDIA     150   // ms de processador de cada média
+
+task_t longa, maisLonga, curta, media[NUMMEDIAS] ;
+mutex_t m1, m2 ;
+int encadeada ;
+int esperaTotal = 0, esperaMaior = 0, rodadas = 0 ;
+
+// usa o processador por t ms (de tempo de processador da tarefa)
+void gasta (int t)
+{
+   int fim = taskExec->running_time + t ;
+
+   while (taskExec->running_time < fim) ;
+}
+
+void Media (void * arg)
+{
+   gasta (MEDIA) ;
+   task_exit (0) ;
+}
+
+void Curta (void * arg)
+{
+   int inicio = systime (), espera ;
+
+   mutex_lock (&m1) ;
+   espera = systime () - inicio ;
+   mutex_unlock (&m1) ;
+
+   esperaTotal += espera ;
+   if (espera > esperaMaior)
+      esperaMaior = espera ;
+   rodadas++ ;
+   printf ("  curta: esperou o mutex por %d ms\n", espera) ;
+   task_exit (0) ;
+}
+
+// obtém m1 e cria a curta e as médias; na versão encadeada espera ainda m2
+void Longa (void * arg)
+{
+   int i ;
+
+   mutex_lock (&m1) ;
+
+   task_create (&curta, Curta, NULL) ;
+   task_set_eet (&curta, 5) ;
+   for (i=0; i<NUMMEDIAS; i++)
+   {
+      task_create (&media[i], Media, NULL) ;
+      task_set_eet (&media[i], 200) ;
+   }
+
+   if (encadeada)
+   {
+      mutex_lock (&m2) ;
+      mutex_unlock (&m2) ;
+   }
+   gasta (POSSE) ;
+   mutex_unlock (&m1) ;
+
+   task_join (&curta) ;
+   for (i=0; i<NUMMEDIAS; i++)
+      task_join (&media[i]) ;
+   task_exit (0) ;
+}
+
+// obtém m2 e cria a longa, que vai esperar por ele
+void MaisLonga (void * arg)
+{
+   mutex_lock (&m2) ;
+
+   task_create (&longa, Longa, NULL) ;
+   task_set_eet (&longa, 1000) ;
+
+   // a longa obtém m1, cria as demais e passa a esperar m2
+   while (longa.mutexEsperado != &m2)
+      task_yield () ;
+
+   gasta (POSSE) ;
+   mutex_unlock (&m2) ;
+
+   task_join (&longa) ;
+   task_exit (0) ;
+}
+
+void rodada ()
+{
+   if (encadeada)
+   {
+      task_create (&maisLonga, MaisLonga, NULL) ;
+      task_set_eet (&maisLonga, 2000) ;
+      task_join (&maisLonga) ;
+   }
+   else
+   {
+      task_create (&longa, Longa, NULL) ;
+      task_set_eet (&longa, 1000) ;
+      task_join (&longa) ;
+   }
+}
+
+int main (int argc, char *argv[])
+{
+   int i, heranca = 1 ;
+
+   if (argc >= 2)
+      heranca = atoi (argv[1]) ;
+   if (ppos_set_inheritance (heranca) < 0)
+   {
+      printf ("main: argumento invalido\n") ;
+      exit (1) ;
+   }
+
+   printf ("main: inicio (heranca de prioridade %s)\n", heranca ? "ligada" : "desligada") ;
+
+   ppos_init () ;
+
+   mutex_create (&m1) ;
+   mutex_create (&m2) ;
+
+   for (encadeada=0; encadeada<2; encadeada++)
+   {
+      esperaTotal = esperaMaior = rodadas = 0 ;
+      printf ("%s:\n", encadeada ? "encadeada" : "simples") ;
+      for (i=0; i<RODADAS; i++)
+         rodada () ;
+      printf ("%s: espera da curta media %.1f ms, maxima %d ms\n",
+              encadeada ? "encadeada" : "simples",
+              rodadas ? (double) esperaTotal / rodadas : 0.0, esperaMaior) ;
+   }
+
+   mutex_destroy (&m1) ;
+   mutex_destroy (&m2) ;
+
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+   exit (0) ;
+}
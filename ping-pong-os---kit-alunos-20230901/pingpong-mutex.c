@@ -0,0 +1,149 @@
+// PingPongOS - PingPong Operating System
+
+// Teste do mutex adaptativo: NUMTASKS tarefas somam num contador protegido
+// por um mutex, com posses curtas e, a cada LONGA passos, uma posse de 5 ms
+// (quem chega cede o processador ao dono e, esgotadas as cedências, espera
+// na fila e recebe o mutex por entrega direta). Uma tarefa extra só tenta
+// obter o mutex com mutex_trylock e mutex_timedlock, e uma tarefa adormecida
+// (task_sleep conta segundos) segura um segundo mutex por 1 s, para esgotar
+// o prazo das esperas. No fim, as estatísticas de posse e espera dos mutexes.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define NUMTASKS 4
+#define NUMSTEPS 2000
+#define LONGA    500
+
+task_t task[NUMTASKS], tentativas, segura ;
+mutex_t m, lento ;
+long soma = 0 ;
+int trySucessos = 0, tryFalhas = 0, timedSucessos = 0, timedFalhas = 0 ;
+
+// usa o processador por t ms
+void gasta (int t)
+{
+   int fim = systime () + t ;
+
+   while (systime () < fim) ;
+}
+
+void Soma (void * arg)
+{
+   int i, j ;
+
+   for (i=0; i<NUMSTEPS; i++)
+   {
+      mutex_lock (&m) ;
+      for (j=0; j<1000; j++)
+         soma++ ;
+      if (i % LONGA == 0)
+         gasta (5) ;
+      mutex_unlock (&m) ;
+   }
+   task_exit (0) ;
+}
+
+void Tentativas (void * arg)
+{
+   int i ;
+
+   for (i=0; i<200; i++)
+   {
+      if (mutex_trylock (&m) == 0)
+      {
+         trySucessos++ ;
+         soma += 1000 ;
+         mutex_unlock (&m) ;
+      }
+      else
+         tryFalhas++ ;
+
+      if (mutex_timedlock (&m, 2) == 0)
+      {
+         timedSucessos++ ;
+         soma += 1000 ;
+         mutex_unlock (&m) ;
+      }
+      else
+         timedFalhas++ ;
+   }
+   task_exit (0) ;
+}
+
+// segura o mutex lento por 1 s, suspensa
+void Segura (void * arg)
+{
+   mutex_lock (&lento) ;
+   task_sleep (1) ;
+   mutex_unlock (&lento) ;
+   task_exit (0) ;
+}
+
+void imprime (char *nome, mutex_t *mutex)
+{
+   printf ("%s: %d aquisicoes, %d disputadas, %d prazos esgotados, "
+           "posse %ld ms, espera %ld ms (maxima %d ms)\n",
+           nome, mutex->aquisicoes, mutex->disputas, mutex->esgotados,
+           mutex->tempoPosse, mutex->tempoEspera, mutex->esperaMaxima) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i, inicio, r ;
+   long esperado ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   mutex_create (&m) ;
+   mutex_create (&lento) ;
+
+   for (i=0; i<NUMTASKS; i++)
+      task_create (&task[i], Soma, NULL) ;
+   task_create (&tentativas, Tentativas, NULL) ;
+   task_create (&segura, Segura, NULL) ;
+
+   // a tarefa Segura obtém o mutex lento na primeira ativação
+   while (lento.dono != &segura)
+      task_yield () ;
+
+   // o mutex está ocupado: trylock falha e timedlock esgota o prazo
+   inicio = systime () ;
+   r = mutex_trylock (&lento) ;
+   printf ("main: trylock no mutex ocupado: %d\n", r) ;
+   r = mutex_timedlock (&lento, 20) ;
+   printf ("main: timedlock de 20 ms no mutex ocupado: %d (apos %d ms)\n",
+           r, systime () - inicio) ;
+
+   // agora espera até a tarefa Segura liberar o mutex (entrega direta)
+   r = mutex_timedlock (&lento, 2000) ;
+   printf ("main: timedlock de 2000 ms: %d (apos %d ms)\n", r, systime () - inicio) ;
+   if (r == 0)
+      mutex_unlock (&lento) ;
+
+   for (i=0; i<NUMTASKS; i++)
+      task_join (&task[i]) ;
+   task_join (&tentativas) ;
+   task_join (&segura) ;
+
+   esperado = (long) NUMTASKS * NUMSTEPS * 1000 + (long) (trySucessos + timedSucessos) * 1000 ;
+   if (soma == esperado)
+      printf ("main: soma deu %ld, valor correto!\n", soma) ;
+   else
+      printf ("main: soma deu %ld, mas deveria ser %ld!\n", soma, esperado) ;
+   printf ("main: trylock %d sucessos e %d falhas, timedlock %d sucessos e %d falhas\n",
+           trySucessos, tryFalhas, timedSucessos, timedFalhas) ;
+
+   imprime ("mutex", &m) ;
+   imprime ("lento", &lento) ;
+
+   mutex_destroy (&m) ;
+   mutex_destroy (&lento) ;
+
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+   exit (0) ;
+}
@@ -0,0 +1,86 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da execução paralela: NUMTASKS tarefas fazem o mesmo processamento
+// pesado de pingpong-preempcao-stress.c, entregando cada rodada a uma thread
+// trabalhadora com task_offload. Mede o tempo total com o número de
+// trabalhadoras indicado (0 executa tudo na thread do PPOS); o tempo deve
+// cair quase linearmente até o número de núcleos do processador. O tempo é
+// medido no relógio do sistema: com as trabalhadoras ocupando os núcleos,
+// disparos do temporizador podem se perder e systime() atrasar.
+// Uso: pingpong-paralelo [trabalhadoras] (o padrão é 4)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ppos.h"
+
+#define WORKLOAD 5000
+#define NUMTASKS 16
+#define RODADAS  3
+
+task_t task[NUMTASKS] ;
+int resultado[NUMTASKS] ;
+
+// simula um processamento pesado (executado pelas trabalhadoras)
+void hardwork (void * arg)
+{
+   int *soma = arg ;
+   int i, j ;
+
+   *soma = 0 ;
+   for (i=0; i<WORKLOAD; i++)
+      for (j=0; j<WORKLOAD; j++)
+         *soma += j ;
+}
+
+// relógio monotônico do sistema, em ms
+long agora ()
+{
+   struct timespec ts ;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts) ;
+   return ts.tv_sec * 1000L + ts.tv_nsec / 1000000 ;
+}
+
+// corpo das tarefas
+void Body (void * arg)
+{
+   int i, n = (long) arg ;
+
+   for (i=0; i<RODADAS; i++)
+      task_offload (hardwork, &resultado[n]) ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i, erros = 0, trabalhadoras = 4 ;
+   long inicio ;
+
+   if (argc > 1)
+      trabalhadoras = atoi (argv[1]) ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   if (trabalhadoras > 0)
+      ppos_set_workers (trabalhadoras) ;
+
+   inicio = agora () ;
+   for (i=0; i<NUMTASKS; i++)
+      task_create (&task[i], Body, (void *) (long) i) ;
+
+   for (i=0; i<NUMTASKS; i++)
+      task_join (&task[i]) ;
+
+   for (i=0; i<NUMTASKS; i++)
+      if (resultado[i] != resultado[0])
+         erros++ ;
+
+   printf ("\n%d trabalhadoras: %d tarefas x %d rodadas em %ld ms (%d resultados divergentes)\n",
+           trabalhadoras, NUMTASKS, RODADAS, agora () - inicio, erros) ;
+
+   printf ("main: fim\n");
+   exit (0);
+}
@@ -0,0 +1,148 @@
+// PingPongOS - PingPong Operating System
+
+// Teste de desempenho das pilhas das tarefas: cria 10000 tarefas de vida
+// curta, em lotes de 100 (cada lote termina antes do próximo ser criado),
+// medindo o custo médio de criação e o maior aumento da memória residente
+// (RSS) do processo. O teste é feito com task_create (pilha padrão) e com
+// task_create_ex pedindo uma pilha pequena. Confere ainda que um pedido
+// maior que a maior classe (1 MB) recebe a pilha inteira e que um
+// makecontext fora do task_create fica com a pilha que recebeu.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <ucontext.h>
+#include "ppos.h"
+
+#define NUMTASKS 10000
+#define LOTE     100
+#define PILHAPEQUENA 8192
+#define PILHAGRANDE  (4 * 1024 * 1024)
+#define USOGRANDE    (3 * 1024 * 1024)
+
+task_t task[LOTE], grande ;
+ucontext_t contextoMain, contextoProprio ;
+char pilhaPropria[65536] ;
+int usouPilhaGrande, argumentos ;
+
+// tempo monotônico em nanossegundos
+double agora ()
+{
+   struct timespec ts ;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts) ;
+   return (ts.tv_sec * 1e9 + ts.tv_nsec) ;
+}
+
+// memória residente do processo, em KB
+long residente ()
+{
+   long paginas = 0 ;
+   FILE *f = fopen ("/proc/self/statm", "r") ;
+
+   if (f)
+   {
+      if (fscanf (f, "%*s %ld", &paginas) != 1)
+         paginas = 0 ;
+      fclose (f) ;
+   }
+   return paginas * (sysconf (_SC_PAGESIZE) / 1024) ;
+}
+
+// corpo das threads: termina logo
+void Body (void * arg)
+{
+   task_exit (0) ;
+}
+
+// cria NUMTASKS tarefas em lotes, com a pilha indicada (0: task_create)
+void mede (int pilha)
+{
+   int n, i ;
+   double t0, criacao = 0 ;
+   long rss0, rss, maior = 0 ;
+
+   rss0 = residente () ;
+   for (n=0; n<NUMTASKS; n+=LOTE)
+   {
+      // durante a criacao a main tem o menor tempo restante, para que as
+      // tarefas so executem depois de medido o custo de criacao
+      task_set_eet (NULL, 0) ;
+
+      t0 = agora () ;
+      for (i=0; i<LOTE; i++)
+      {
+         if (pilha == 0)
+            task_create (&task[i], Body, NULL) ;
+         else
+            task_create_ex (&task[i], Body, NULL, pilha) ;
+         task_set_eet (&task[i], 1000) ;
+      }
+      criacao += agora () - t0 ;
+
+      rss = residente () - rss0 ;
+      if (rss > maior)
+         maior = rss ;
+
+      task_set_eet (NULL, 99999) ;
+      for (i=0; i<LOTE; i++)
+         task_join (&task[i]) ;
+   }
+
+   printf ("%10s %14.0f %12ld\n", (pilha == 0) ? "padrao" : "8K",
+           criacao / NUMTASKS, maior) ;
+}
+
+// usa USOGRANDE bytes da pilha (mais que a maior classe)
+void Grande (void * arg)
+{
+   char local[USOGRANDE] ;
+
+   memset (local, 1, sizeof (local)) ;
+   usouPilhaGrande = (local[0] + local[USOGRANDE - 1] == 2) ;
+   task_exit (0) ;
+}
+
+// contexto criado pela aplicação, com dois argumentos
+void Proprio (int a, int b)
+{
+   argumentos = a + b ;
+}
+
+int main (int argc, char *argv[])
+{
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   printf ("\n%10s %14s %12s\n", "pilha", "criacao (ns)", "RSS (KB)") ;
+   mede (0) ;
+   mede (PILHAPEQUENA) ;
+
+   if (task_create_ex (&grande, Grande, NULL, PILHAGRANDE) > 0)
+   {
+      task_join (&grande) ;
+      printf ("main: pilha de %d KB %s\n", PILHAGRANDE / 1024,
+              usouPilhaGrande ? "usada, correto!" : "nao usada!") ;
+   }
+   else
+      printf ("main: task_create_ex de %d KB falhou\n", PILHAGRANDE / 1024) ;
+
+   getcontext (&contextoProprio) ;
+   contextoProprio.uc_stack.ss_sp = pilhaPropria ;
+   contextoProprio.uc_stack.ss_size = sizeof (pilhaPropria) ;
+   contextoProprio.uc_link = &contextoMain ;
+   makecontext (&contextoProprio, (void (*)(void)) Proprio, 2, 20, 22) ;
+   if (contextoProprio.uc_stack.ss_sp == pilhaPropria)
+   {
+      swapcontext (&contextoMain, &contextoProprio) ;
+      printf ("main: makecontext da aplicacao: pilha mantida, argumentos %d\n", argumentos) ;
+   }
+   else
+      printf ("main: makecontext da aplicacao trocou a pilha!\n") ;
+
+   printf ("main: fim\n");
+   exit (0);
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "ppos.h"
 
 // operating system check
@@ -15,14 +16,23 @@ task_t task[NUMTASKS] ;
 semaphore_t  s ;
 long int soma = 0 ;
 
-void taskBody(char *id)
+// tempo monotônico em nanossegundos
+double agora ()
+{
+   struct timespec ts ;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts) ;
+   return (ts.tv_sec * 1e9 + ts.tv_nsec) ;
+}
+
+void taskBody(void *arg)
 {
    int i ;
 
    for (i=0; i< NUMSTEPS; i++)
    {
       sem_down (&s) ;
-      //printf("\n%s\t\t\tSETP = %d\t\tSOMA = %d", id, i, soma);
+      //printf("\n%s\t\t\tSETP = %d\t\tSOMA = %d", (char *) arg, i, soma);
       //fflush(stdout);
       soma += 1 ;
       sem_up (&s) ;
@@ -34,6 +44,7 @@ void taskBody(char *id)
 int main (int argc, char *argv[])
 {
    int i ;
+   double t0, t1 ;
    
    printf ("Main INICIO\n") ;
 
@@ -41,6 +52,21 @@ int main (int argc, char *argv[])
 
    sem_create (&s, 1) ;
 
+   // custo de um par sem_down/sem_up sem disputa: só a main usa o semáforo
+   t0 = agora () ;
+   for (i=0; i<NUMSTEPS; i++)
+   {
+      sem_down (&s) ;
+      sem_up (&s) ;
+   }
+   t1 = agora () ;
+#ifdef SEMHOOKS
+   printf ("semaforo: caminho do nucleo (hooks)\n") ;
+#else
+   printf ("semaforo: caminho rapido\n") ;
+#endif
+   printf ("par sem_down/sem_up sem disputa: %.1f ns\n", (t1 - t0) / NUMSTEPS) ;
+
    printf ("%d tarefas somando %d vezes cada, aguarde...\n",
            NUMTASKS, NUMSTEPS) ;
 
@@ -53,8 +79,10 @@ int main (int argc, char *argv[])
    }
    fflush(stdout);
 
+   t0 = agora () ;
    for (i=0; i<NUMTASKS; i++)
      task_join (&task[i]) ;
+   t1 = agora () ;
 
    sem_destroy (&s) ;
 
@@ -64,6 +92,9 @@ int main (int argc, char *argv[])
      printf ("Soma deu %ld, mas deveria ser %d!\n",
              soma, NUMTASKS*NUMSTEPS) ;
 
+   printf ("%d tarefas: %.1f ns por par sem_down/sem_up (com a soma)\n",
+           NUMTASKS, (t1 - t0) / ((double) NUMTASKS * NUMSTEPS)) ;
+
    task_exit (0) ;
 
    exit (0) ;
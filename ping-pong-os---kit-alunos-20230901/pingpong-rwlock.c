@@ -0,0 +1,164 @@
+// PingPongOS - PingPong Operating System
+
+// Teste do rwlock: NUMTASKS tarefas consultam e atualizam uma tabela
+// compartilhada por DURACAO ms, protegida por um mutex ou por um rwlock,
+// com 90% e 99% de leituras. Cada escrita incrementa todas as posições da
+// tabela e cada leitura confere que todas têm o mesmo valor (uma leitura
+// inconsistente indica exclusão mútua violada). Informa a vazão (operações
+// por ms) de cada combinação e quantas operações esperaram na fila da
+// trava. Com um único processador a vazão quase não muda; o que muda é a
+// serialização: com o mutex, um leitor preemptado no meio da leitura
+// bloqueia os demais, e a entrega direta mantém daí em diante uma troca de
+// contexto por operação; com o rwlock, só as escritas separam os leitores.
+// Por fim, com um leitor dentro e um escritor esperando, uma tarefa que não
+// detém o rwlock tenta liberá-lo: deve receber -1, e o escritor só pode
+// entrar depois que o leitor sair.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define NUMTASKS 8
+#define TAMANHO  16384
+#define DURACAO  1000
+
+task_t task[NUMTASKS] ;
+mutex_t m ;
+rwlock_t rw ;
+int tabela[TAMANHO] ;
+int usaRwlock, percentualLeitura, fim ;
+long leituras, escritas, inconsistentes ;
+task_t leitor, escritor ;
+semaphore_t sai ;
+int leitorSaiu, escritorEntrouAntes ;
+
+void trava (int escrita)
+{
+   if (!usaRwlock)
+      mutex_lock (&m) ;
+   else if (escrita)
+      rwlock_wrlock (&rw) ;
+   else
+      rwlock_rdlock (&rw) ;
+}
+
+void destrava ()
+{
+   if (usaRwlock)
+      rwlock_unlock (&rw) ;
+   else
+      mutex_unlock (&m) ;
+}
+
+void Corpo (void * arg)
+{
+   unsigned int semente = (long) arg + 1 ;
+   int i, primeiro ;
+
+   while (systime () < fim)
+   {
+      // gerador congruente linear, igual em todas as execuções
+      semente = semente * 1103515245 + 12345 ;
+      if ((semente >> 16) % 100 < percentualLeitura)
+      {
+         trava (0) ;
+         primeiro = tabela[0] ;
+         for (i=1; i<TAMANHO; i++)
+            if (tabela[i] != primeiro)
+               break ;
+         if (i < TAMANHO)
+            inconsistentes++ ;
+         leituras++ ;
+         destrava () ;
+      }
+      else
+      {
+         trava (1) ;
+         for (i=0; i<TAMANHO; i++)
+            tabela[i]++ ;
+         escritas++ ;
+         destrava () ;
+      }
+   }
+   task_exit (0) ;
+}
+
+// lê até a tarefa main mandar sair
+void Leitor (void * arg)
+{
+   rwlock_rdlock (&rw) ;
+   sem_down (&sai) ;
+   leitorSaiu = 1 ;
+   rwlock_unlock (&rw) ;
+   task_exit (0) ;
+}
+
+void Escritor (void * arg)
+{
+   rwlock_wrlock (&rw) ;
+   escritorEntrouAntes = !leitorSaiu ;
+   rwlock_unlock (&rw) ;
+   task_exit (0) ;
+}
+
+void mede (int rwlock, int leitura)
+{
+   int i, esperas ;
+
+   usaRwlock = rwlock ;
+   percentualLeitura = leitura ;
+   leituras = escritas = inconsistentes = 0 ;
+   m.disputas = rw.esperasLeitura = rw.esperasEscrita = 0 ;
+   fim = systime () + DURACAO ;
+
+   for (i=0; i<NUMTASKS; i++)
+      task_create (&task[i], Corpo, (void *) (long) i) ;
+   for (i=0; i<NUMTASKS; i++)
+      task_join (&task[i]) ;
+
+   esperas = rwlock ? rw.esperasLeitura + rw.esperasEscrita : m.disputas ;
+   printf ("%-6s %d/%d: %.1f operacoes/ms (%ld leituras, %ld escritas, %ld inconsistentes), "
+           "%d esperaram a trava (%.1f%%)\n",
+           rwlock ? "rwlock" : "mutex", leitura, 100 - leitura,
+           (double) (leituras + escritas) / DURACAO, leituras, escritas, inconsistentes,
+           esperas, 100.0 * esperas / (leituras + escritas)) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int r ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   mutex_create (&m) ;
+   rwlock_create (&rw) ;
+
+   mede (0, 90) ;
+   mede (1, 90) ;
+   mede (0, 99) ;
+   mede (1, 99) ;
+
+   // só quem detém o rwlock pode liberá-lo
+   sem_create (&sai, 0) ;
+   task_create (&leitor, Leitor, NULL) ;
+   task_yield () ;
+   task_create (&escritor, Escritor, NULL) ;
+   task_yield () ;
+   r = rwlock_unlock (&rw) ;
+   printf ("main: rwlock_unlock sem deter o rwlock: %d (%d leitores)\n", r, rw.leitores) ;
+   sem_up (&sai) ;
+   task_join (&leitor) ;
+   task_join (&escritor) ;
+   sem_destroy (&sai) ;
+   if (r == -1 && !escritorEntrouAntes)
+      printf ("main: escritor entrou so depois do leitor, correto!\n") ;
+
+   mutex_destroy (&m) ;
+   rwlock_destroy (&rw) ;
+
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+   exit (0) ;
+}
@@ -0,0 +1,76 @@
+// PingPongOS - PingPong Operating System
+
+// Teste de latência de escalonamento com muitas tarefas: NUMTASKS tarefas
+// que só usam o processador executam por DURACAO ms. Cada tarefa mede o
+// maior intervalo em que ficou sem o processador; o pior caso deve ficar
+// limitado pela latência alvo do CFS (ou pela granularidade mínima vezes o
+// número de tarefas), e não pelo quantum fixo vezes o número de tarefas.
+// Uso: pingpong-scheduler-cfs [srtf|cfs] (o padrão é cfs)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ppos.h"
+
+#define NUMTASKS 200
+#define DURACAO  8000
+
+task_t task[NUMTASKS] ;
+int esperaMax[NUMTASKS] ;
+
+// corpo das tarefas: usa o processador até DURACAO ms, medindo os intervalos
+// em que ficou sem ele
+void Body (void * arg)
+{
+   int n = (long) arg ;
+   int agora, ultima = systime () ;
+
+   while ((agora = systime ()) < DURACAO)
+   {
+      if (agora - ultima > esperaMax[n])
+         esperaMax[n] = agora - ultima ;
+      ultima = agora ;
+   }
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i, politica = PPOS_SCHED_CFS ;
+   int pior = 0, menor, maior ;
+   long soma = 0 ;
+
+   if (argc > 1 && strcmp (argv[1], "srtf") == 0)
+      politica = PPOS_SCHED_SRTF ;
+   ppos_set_scheduler (politica) ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   for (i=0; i<NUMTASKS; i++)
+      task_create (&task[i], Body, (void *) (long) i) ;
+
+   for (i=0; i<NUMTASKS; i++)
+      task_join (&task[i]) ;
+
+   menor = maior = task[0].running_time ;
+   for (i=0; i<NUMTASKS; i++)
+   {
+      soma += esperaMax[i] ;
+      if (esperaMax[i] > pior)
+         pior = esperaMax[i] ;
+      if (task[i].running_time < menor)
+         menor = task[i].running_time ;
+      if (task[i].running_time > maior)
+         maior = task[i].running_time ;
+   }
+
+   printf ("\n%s: espera maxima media %ld ms, pior %d ms\n",
+           (politica == PPOS_SCHED_CFS) ? "cfs" : "srtf",
+           soma / NUMTASKS, pior) ;
+   printf ("tempo de processador por tarefa: de %d a %d ms\n", menor, maior) ;
+
+   printf ("main: fim\n");
+   exit (0);
+}
@@ -0,0 +1,122 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da classe de tempo real (EDF): NUMRT tarefas periódicas, com
+// utilização total de 60%, disputam o processador com NUMHOGS tarefas que
+// só usam o processador. Cada tarefa periódica usa quase todo o seu
+// orçamento em cada período; nenhum prazo deve ser perdido. Uma tarefa a
+// mais, que levaria a utilização a 110%, deve ser recusada pelo controle
+// de admissão. Por fim, o relógio é adiantado para VOLTA ms antes da volta
+// do systemTime e duas tarefas recebem prazos em lados opostos dela: a de
+// prazo anterior à volta deve executar primeiro e nenhuma perde prazo.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+#include "ppos-core-globals.h"
+
+#define NUMRT    3
+#define NUMHOGS  3
+#define PERIODOS 10
+#define DURACAO  2500
+#define VOLTA    30     // ms antes da volta do systemTime
+
+extern unsigned int tempoRoda ;  // relógio da roda de tarefas dormindo (ppos-core-aux.c)
+
+task_t rt[NUMRT], hog[NUMHOGS], extra, antes, depois ;
+task_t *primeira ;
+int periodo[NUMRT]   = { 50, 100, 200} ;
+int orcamento[NUMRT] = { 10,  20,  40} ;
+
+// usa o processador por t ms (de tempo de processador da tarefa)
+void gasta (int t)
+{
+   int fim = taskExec->running_time + t ;
+
+   while (taskExec->running_time < fim) ;
+}
+
+// corpo das tarefas periódicas
+void TempoReal (void * arg)
+{
+   int i, n = (long) arg ;
+
+   for (i=0; i<PERIODOS; i++)
+   {
+      gasta (orcamento[n] - 2) ;
+      task_wait_period () ;
+   }
+   task_exit (0) ;
+}
+
+// corpo das tarefas periódicas do teste da volta do relógio
+void TempoRealVolta (void * arg)
+{
+   int i ;
+
+   if (primeira == NULL)
+      primeira = taskExec ;
+   for (i=0; i<PERIODOS; i++)
+   {
+      gasta (taskExec->orcamento - 2) ;
+      task_wait_period () ;
+   }
+   task_exit (0) ;
+}
+
+// corpo das tarefas que só usam o processador (até DURACAO ms)
+void Hog (void * arg)
+{
+   while (systime () < DURACAO) ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   for (i=0; i<NUMHOGS; i++)
+      task_create (&hog[i], Hog, NULL) ;
+
+   for (i=0; i<NUMRT; i++)
+   {
+      task_create (&rt[i], TempoReal, (void *) (long) i) ;
+      if (task_set_deadline (&rt[i], periodo[i], orcamento[i], periodo[i]) < 0)
+         printf ("main: tarefa %d recusada\n", rt[i].id) ;
+   }
+
+   task_create (&extra, Hog, NULL) ;
+   if (task_set_deadline (&extra, 100, 50, 100) < 0)
+      printf ("main: tarefa extra (utilizacao 50%%) recusada\n") ;
+
+   for (i=0; i<NUMRT; i++)
+      task_join (&rt[i]) ;
+
+   for (i=0; i<NUMHOGS; i++)
+      task_join (&hog[i]) ;
+   task_join (&extra) ;
+
+   // prazos: o de depois (VOLTA + 30 ms) cai após a volta e o de antes
+   // (VOLTA - 10 ms) antes dela; com o orçamento de depois executado
+   // primeiro, antes perderia o prazo
+   PPOS_PREEMPT_DISABLE
+   systemTime = tempoRoda = 0U - VOLTA ;
+   task_create (&depois, TempoRealVolta, NULL) ;
+   task_create (&antes, TempoRealVolta, NULL) ;
+   task_set_deadline (&depois, 100, 20, VOLTA + 30) ;
+   task_set_deadline (&antes, 100, 8, VOLTA - 10) ;
+   PPOS_PREEMPT_ENABLE
+   task_join (&antes) ;
+   task_join (&depois) ;
+
+   printf ("main: volta do relogio: primeira a executar: %s, %d e %d prazos perdidos\n",
+           primeira == &antes ? "antes" : "depois", antes.perdasPrazo, depois.perdasPrazo) ;
+   if (primeira == &antes && antes.perdasPrazo + depois.perdasPrazo == 0)
+      printf ("main: prazos dos dois lados da volta do relogio respeitados, correto!\n") ;
+
+   printf ("main: fim\n");
+   exit (0);
+}
@@ -0,0 +1,187 @@
+// PingPongOS - PingPong Operating System
+
+// Teste de inanição no SRTF: NUMLONGAS tarefas longas (CPULONGA ms) disputam
+// o processador com tarefas curtas (CPUCURTA ms), criadas em lotes de
+// POR_LOTE a cada 100 ms por uma tarefa periódica de tempo real até FASE ms,
+// com carga um pouco acima da capacidade. Sem envelhecimento as longas só
+// voltam ao processador depois que as curtas param de chegar. Cada tarefa
+// registra os intervalos em que ficou sem o processador (inclusive a espera
+// inicial); no fim são mostrados o percentil 99 e o máximo de cada classe.
+// Com espera máxima, confere a garantia do escalonador: a tarefa que esperou
+// a espera máxima recebe o processador antes de toda tarefa (que não é de
+// tempo real) que ficou pronta depois dela. A carga passa da capacidade, e as
+// tarefas que vencem a espera máxima se acumulam: as esperas medidas podem
+// passar dela. Os instantes vêm de systime(), que avança aos saltos com
+// -DTICKLESS: nesse modo as medidas não valem.
+// Uso: pingpong-scheduler-envelhecimento [taxa espera] (o padrão é 100 200;
+// taxa 0 desliga o envelhecimento)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+#include "ppos-core-globals.h"
+
+#define NUMLONGAS 3
+#define CPULONGA  210
+#define CPUCURTA  15
+#define POR_LOTE  7
+#define FASE      3000
+#define AMOSTRAS  10000
+
+task_t longa[NUMLONGAS], gerador ;
+int curtasCriadas = 0, curtasTerminadas = 0 ;
+
+// intervalos sem processador de cada classe: do instante em que a tarefa
+// ficou pronta até o instante em que voltou ao processador
+typedef struct {
+   int n ;
+   int pronta[AMOSTRAS], despacho[AMOSTRAS], espera[AMOSTRAS] ;
+} amostras_t ;
+
+amostras_t esperasCurtas, esperasLongas ;
+
+void registra (amostras_t *a, int pronta, int despacho)
+{
+   if (a->n < AMOSTRAS)
+   {
+      a->pronta[a->n] = pronta ;
+      a->despacho[a->n] = despacho ;
+      a->espera[a->n] = despacho - pronta ;
+      a->n++ ;
+   }
+}
+
+// usa t ms de processador, registrando as esperas em a
+void executa (amostras_t *a, int t)
+{
+   int agora, ultima = systime () ;
+   int fim = taskExec->running_time + t ;
+
+   registra (a, taskExec->inicio, ultima) ;
+   while (taskExec->running_time < fim)
+   {
+      agora = systime () ;
+      if (agora - ultima > 1)
+         registra (a, ultima, agora) ;
+      ultima = agora ;
+   }
+}
+
+void Curta (void * arg)
+{
+   executa (&esperasCurtas, CPUCURTA) ;
+   curtasTerminadas++ ;
+   task_exit (0) ;
+}
+
+void Longa (void * arg)
+{
+   executa (&esperasLongas, CPULONGA) ;
+   task_exit (0) ;
+}
+
+// cria um lote de tarefas curtas a cada período
+void Gerador (void * arg)
+{
+   task_t *task ;
+   int i ;
+
+   while (systime () < FASE)
+   {
+      for (i=0; i<POR_LOTE; i++)
+      {
+         task = task_spawn (Curta, NULL) ;
+         task_set_eet (task, CPUCURTA) ;
+         task_release (task) ;
+         curtasCriadas++ ;
+      }
+      task_wait_period () ;
+   }
+   task_exit (0) ;
+}
+
+int compara (const void *a, const void *b)
+{
+   return *(int *) a - *(int *) b ;
+}
+
+// conta as esperas de b despachadas antes da espera i de a, embora tenham
+// começado depois dela e a espera máxima de a já tivesse vencido; os
+// instantes são vistos pelas tarefas com 1 ms de incerteza
+int foraDeOrdem (amostras_t *a, int i, amostras_t *b, int espera)
+{
+   int j, erros = 0 ;
+
+   for (j=0; j<b->n; j++)
+      if (b->pronta[j] >= a->pronta[i] + 2
+          && b->despacho[j] >= a->pronta[i] + espera + 2
+          && b->despacho[j] < a->despacho[i] - 1)
+         erros++ ;
+   return erros ;
+}
+
+int violacoes (int espera)
+{
+   int i, erros = 0 ;
+
+   for (i=0; i<esperasCurtas.n; i++)
+      erros += foraDeOrdem (&esperasCurtas, i, &esperasCurtas, espera)
+             + foraDeOrdem (&esperasCurtas, i, &esperasLongas, espera) ;
+   for (i=0; i<esperasLongas.n; i++)
+      erros += foraDeOrdem (&esperasLongas, i, &esperasCurtas, espera)
+             + foraDeOrdem (&esperasLongas, i, &esperasLongas, espera) ;
+   return erros ;
+}
+
+void relatorio (char *nome, amostras_t *a)
+{
+   qsort (a->espera, a->n, sizeof (int), compara) ;
+   printf ("%8s %8d %8d %8d\n", nome, a->n,
+           a->n ? a->espera[(a->n * 99) / 100] : 0,
+           a->n ? a->espera[a->n - 1] : 0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i, taxa = 100, espera = 200 ;
+
+   if (argc > 2)
+   {
+      taxa = atoi (argv[1]) ;
+      espera = atoi (argv[2]) ;
+   }
+   ppos_set_scheduler (PPOS_SCHED_SRTF) ;
+   ppos_set_aging (taxa, espera) ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   for (i=0; i<NUMLONGAS; i++)
+   {
+      task_create (&longa[i], Longa, NULL) ;
+      task_set_eet (&longa[i], CPULONGA) ;
+   }
+   task_create (&gerador, Gerador, NULL) ;
+   task_set_deadline (&gerador, 100, 5, 100) ;
+
+   for (i=0; i<NUMLONGAS; i++)
+      task_join (&longa[i]) ;
+   task_join (&gerador) ;
+   while (curtasTerminadas < curtasCriadas)
+      task_yield () ;
+
+   printf ("\nenvelhecimento: taxa %d%%, espera maxima %d ms\n", taxa, espera) ;
+   if (espera > 0)
+   {
+      i = violacoes (espera) ;
+      printf ("%d despachos passaram a frente de espera vencida%s\n", i,
+              i ? "" : ", correto!") ;
+   }
+   printf ("%8s %8s %8s %8s\n", "classe", "esperas", "p99 (ms)", "max (ms)") ;
+   relatorio ("curtas", &esperasCurtas) ;
+   relatorio ("longas", &esperasLongas) ;
+
+   printf ("main: fim\n");
+   exit (0);
+}
@@ -0,0 +1,81 @@
+// PingPongOS - PingPong Operating System
+
+// Teste de escalabilidade do escalonador SRTF: mede o custo médio de um
+// despacho (task_yield -> dispatcher -> scheduler -> task_switch) com
+// 10, 100, 1000 e 10000 tarefas prontas, cada uma com um tempo estimado
+// diferente.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ppos.h"
+
+#define MAXTASKS 10000
+#define ROUNDS   20
+#define NUMCASES 4
+
+task_t task[MAXTASKS] ;
+int numTasks[NUMCASES] = {10, 100, 1000, 10000} ;
+double custoCriacao[NUMCASES], custoDespacho[NUMCASES] ;
+
+// tempo monotônico em nanossegundos
+double agora ()
+{
+   struct timespec ts ;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts) ;
+   return (ts.tv_sec * 1e9 + ts.tv_nsec) ;
+}
+
+// corpo das threads: apenas devolve o processador ROUNDS vezes
+void Body (void * arg)
+{
+   int i ;
+
+   for (i=0; i<ROUNDS; i++)
+      task_yield () ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int c, i, n ;
+   double t0, t1, t2 ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   for (c=0; c<NUMCASES; c++)
+   {
+      n = numTasks[c] ;
+
+      // durante a criacao a main tem o menor tempo restante, para que as
+      // tarefas criadas so executem depois de medido o custo de criacao
+      task_set_eet (NULL, 0) ;
+
+      t0 = agora () ;
+      for (i=0; i<n; i++)
+      {
+         task_create (&task[i], Body, NULL) ;
+         task_set_eet (&task[i], 1000 + random() % 1000) ;
+      }
+      t1 = agora () ;
+
+      task_set_eet (NULL, 99999) ;
+
+      for (i=0; i<n; i++)
+         task_join (&task[i]) ;
+      t2 = agora () ;
+
+      custoCriacao[c]  = (t1 - t0) / n ;
+      custoDespacho[c] = (t2 - t1) / ((double) n * (ROUNDS + 1)) ;
+   }
+
+   printf ("\n%8s %14s %14s\n", "tarefas", "criacao (ns)", "despacho (ns)") ;
+   for (c=0; c<NUMCASES; c++)
+      printf ("%8d %14.0f %14.0f\n", numTasks[c], custoCriacao[c], custoDespacho[c]) ;
+
+   printf ("main: fim\n");
+   exit (0);
+}
@@ -0,0 +1,84 @@
+// PingPongOS - PingPong Operating System
+
+// Teste dos grupos de tarefas (política CFS): o grupo A, com NUMA tarefas que
+// só usam o processador, é limitado a QUOTA ms a cada PERIODO ms. O grupo B
+// tem as mesmas cotas que A e dois subgrupos, B1 e B2 (cotas 1:3), com uma
+// tarefa cada. Sem o limite, A e B dividiriam o processador ao meio, qualquer
+// que fosse o número de tarefas de A; com ele, A fica com QUOTA/PERIODO e B
+// com o resto, dividido 1:3 entre B1 e B2.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define NUMA     6
+#define PERIODO  100
+#define QUOTA    30
+#define DURACAO  6000
+
+task_t taskA[NUMA], taskB1, taskB2 ;
+taskgroup_t grupoA, grupoB, grupoB1, grupoB2 ;
+
+// corpo das tarefas: usa o processador até DURACAO ms
+void Body (void * arg)
+{
+   while (systime () < DURACAO) ;
+   task_exit (0) ;
+}
+
+// imprime os totais de um grupo e a fração do processador que ele recebeu
+void relatorio (char *nome, taskgroup_t *grupo, double esperada, int total)
+{
+   printf ("%6s %10d %10d %12.1f %12.1f\n", nome, grupo->running_time,
+           grupo->tempoDeEspera, esperada, 100.0 * grupo->running_time / total) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i, total ;
+
+   ppos_set_scheduler (PPOS_SCHED_CFS) ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   taskgroup_create (&grupoA, NULL, 1024) ;
+   taskgroup_create (&grupoB, NULL, 1024) ;
+   taskgroup_create (&grupoB1, &grupoB, 1024) ;
+   taskgroup_create (&grupoB2, &grupoB, 3072) ;
+   taskgroup_set_bandwidth (&grupoA, PERIODO, QUOTA) ;
+
+   for (i=0; i<NUMA; i++)
+   {
+      task_create (&taskA[i], Body, NULL) ;
+      task_join_group (&taskA[i], &grupoA) ;
+   }
+   task_create (&taskB1, Body, NULL) ;
+   task_join_group (&taskB1, &grupoB1) ;
+   task_create (&taskB2, Body, NULL) ;
+   task_join_group (&taskB2, &grupoB2) ;
+
+   for (i=0; i<NUMA; i++)
+      task_join (&taskA[i]) ;
+   task_join (&taskB1) ;
+   task_join (&taskB2) ;
+
+   total = grupoA.running_time + grupoB.running_time ;
+
+   printf ("\n%6s %10s %10s %12s %12s\n", "grupo", "cpu (ms)", "espera (ms)",
+           "esperada (%)", "medida (%)") ;
+   relatorio ("A",  &grupoA,  100.0 * QUOTA / PERIODO, total) ;
+   relatorio ("B",  &grupoB,  100.0 - 100.0 * QUOTA / PERIODO, total) ;
+   relatorio ("B1", &grupoB1, (100.0 - 100.0 * QUOTA / PERIODO) / 4, total) ;
+   relatorio ("B2", &grupoB2, (100.0 - 100.0 * QUOTA / PERIODO) * 3 / 4, total) ;
+
+   // as tarefas terminadas já deixaram os seus grupos
+   taskgroup_destroy (&grupoB1) ;
+   taskgroup_destroy (&grupoB2) ;
+   taskgroup_destroy (&grupoB) ;
+   taskgroup_destroy (&grupoA) ;
+
+   printf ("main: fim\n");
+   exit (0);
+}
@@ -0,0 +1,74 @@
+// PingPongOS - PingPong Operating System
+
+// Teste de latência de resposta: uma tarefa interativa dorme 1 s por vez
+// enquanto NUMHOGS tarefas só usam o processador. Mede quanto tempo a
+// tarefa interativa espera para voltar ao processador depois de acordar.
+// Uso: pingpong-scheduler-mlfq [srtf|mlfq] (o padrão é mlfq)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ppos.h"
+
+#define NUMHOGS 4
+#define ROUNDS  5
+#define SONO    1
+
+task_t hog[NUMHOGS], interativa ;
+volatile int fim = 0 ;
+int latenciaMax = 0, latenciaTotal = 0 ;
+
+// corpo das tarefas que só usam o processador
+void Hog (void * arg)
+{
+   while (!fim) ;
+   task_exit (0) ;
+}
+
+// corpo da tarefa interativa: dorme e mede o atraso ao acordar
+void Interativa (void * arg)
+{
+   int i, antes, latencia ;
+
+   for (i=0; i<ROUNDS; i++)
+   {
+      antes = systime () ;
+      task_sleep (SONO) ;
+      latencia = systime () - antes - SONO * 1000 ;
+      if (latencia < 0)
+         latencia = 0 ;
+      latenciaTotal += latencia ;
+      if (latencia > latenciaMax)
+         latenciaMax = latencia ;
+   }
+   fim = 1 ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i, politica = PPOS_SCHED_MLFQ ;
+
+   if (argc > 1 && strcmp (argv[1], "srtf") == 0)
+      politica = PPOS_SCHED_SRTF ;
+   ppos_set_scheduler (politica) ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   for (i=0; i<NUMHOGS; i++)
+      task_create (&hog[i], Hog, NULL) ;
+   task_create (&interativa, Interativa, NULL) ;
+
+   task_join (&interativa) ;
+   for (i=0; i<NUMHOGS; i++)
+      task_join (&hog[i]) ;
+
+   printf ("\n%s: latencia media %.1f ms, maxima %d ms\n",
+           (politica == PPOS_SCHED_MLFQ) ? "mlfq" : "srtf",
+           (double) latenciaTotal / ROUNDS, latenciaMax) ;
+
+   printf ("main: fim\n");
+   exit (0);
+}
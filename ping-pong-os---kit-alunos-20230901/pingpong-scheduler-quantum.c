@@ -0,0 +1,116 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da fatia de tempo adaptativa (ppos_set_quantum): NUMLOTE tarefas que
+// só usam o processador (contando iterações, a vazão) disputam o processador
+// com até NUMES tarefas limitadas por E/S, que leem blocos do disco e usam
+// 1 ms de processador por bloco, por DURACAO ms. Com a fatia adaptativa as
+// tarefas de lote devem ser ativadas menos vezes (e contar mais), e as
+// leituras não devem esperar o fim das suas fatias longas.
+// Uso: pingpong-scheduler-quantum [min max [leitoras]]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+#include "ppos-core-globals.h"
+#include "ppos_disk.h"
+
+#define NUMLOTE 3
+#define NUMES   2
+#define DURACAO 6000
+
+task_t lote[NUMLOTE], es[NUMES] ;
+long iteracoes[NUMLOTE] ;
+int numblocks, blocksize, numES = NUMES ;
+int leituras = 0, respostaTotal = 0, respostaMax = 0 ;
+
+// usa o processador por t ms (de tempo de processador da tarefa)
+void gasta (int t)
+{
+   int fim = taskExec->running_time + t ;
+
+   while (taskExec->running_time < fim) ;
+}
+
+// corpo das tarefas de lote: conta iterações até DURACAO ms
+void Lote (void * arg)
+{
+   int n = (long) arg ;
+
+   while (systime () < DURACAO)
+      iteracoes[n]++ ;
+   task_exit (0) ;
+}
+
+// corpo das tarefas de E/S: lê um bloco, usa 1 ms e repete até DURACAO ms
+void Leitora (void * arg)
+{
+   int n = (long) arg, bloco = n, inicio, resposta ;
+   char *buffer = malloc (blocksize) ;
+
+   while (systime () < DURACAO)
+   {
+      inicio = systime () ;
+      if (disk_block_read (bloco, buffer) < 0)
+         printf ("Erro na leitura do bloco %d\n", bloco) ;
+      resposta = systime () - inicio ;
+      respostaTotal += resposta ;
+      if (resposta > respostaMax)
+         respostaMax = resposta ;
+      leituras++ ;
+
+      gasta (1) ;
+      bloco = (bloco + numES) % numblocks ;
+   }
+   free (buffer) ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i, ativacoesLote = 0, ativacoesES = 0 ;
+   long vazao = 0 ;
+
+   if (argc >= 3 && ppos_set_quantum (atoi (argv[1]), atoi (argv[2])) < 0)
+   {
+      printf ("main: limites de fatia invalidos\n") ;
+      exit (1) ;
+   }
+   if (argc >= 4 && atoi (argv[3]) >= 0 && atoi (argv[3]) <= NUMES)
+      numES = atoi (argv[3]) ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("main: erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   for (i=0; i<numES; i++)
+      task_create (&es[i], Leitora, (void *) (long) i) ;
+   for (i=0; i<NUMLOTE; i++)
+      task_create (&lote[i], Lote, (void *) (long) i) ;
+
+   for (i=0; i<NUMLOTE; i++)
+   {
+      task_join (&lote[i]) ;
+      ativacoesLote += lote[i].ativacoes ;
+      vazao += iteracoes[i] ;
+   }
+   for (i=0; i<numES; i++)
+   {
+      task_join (&es[i]) ;
+      ativacoesES += es[i].ativacoes ;
+   }
+
+   printf ("\nlote: %d ativacoes, %ld iteracoes/ms\n",
+           ativacoesLote, vazao / DURACAO) ;
+   printf ("e/s: %d ativacoes, %d leituras, resposta media %.1f ms, maxima %d ms\n",
+           ativacoesES, leituras, leituras ? (double) respostaTotal / leituras : 0.0,
+           respostaMax) ;
+
+   printf ("main: fim\n");
+   exit (0);
+}
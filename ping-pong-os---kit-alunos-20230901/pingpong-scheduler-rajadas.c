@@ -0,0 +1,77 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da estimativa automática de rajadas do SRTF: NUMCURTAS tarefas de
+// rajadas curtas (1 ms de CPU e task_yield) disputam o processador com
+// NUMLONGAS tarefas que só usam o processador. Nenhuma tarefa chama
+// task_set_eet; o escalonador deve aprender a despachar primeiro as
+// rajadas curtas. Mede o tempo médio de retorno (turnaround) de cada grupo.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+#include "ppos-core-globals.h"
+
+#define NUMCURTAS 4
+#define NUMLONGAS 4
+#define ROUNDS    20
+#define CPULONGA  200
+
+task_t curta[NUMCURTAS], longa[NUMLONGAS] ;
+int retornoCurtas = 0, retornoLongas = 0 ;
+
+// usa o processador por t ms (de tempo de processador da tarefa)
+void gasta (int t)
+{
+   int fim = taskExec->running_time + t ;
+
+   while (taskExec->running_time < fim) ;
+}
+
+// corpo das tarefas de rajadas curtas
+void Curta (void * arg)
+{
+   int i, inicio = systime () ;
+
+   for (i=0; i<ROUNDS; i++)
+   {
+      gasta (1) ;
+      task_yield () ;
+   }
+   retornoCurtas += systime () - inicio ;
+   task_exit (0) ;
+}
+
+// corpo das tarefas que só usam o processador
+void Longa (void * arg)
+{
+   int inicio = systime () ;
+
+   gasta (CPULONGA) ;
+   retornoLongas += systime () - inicio ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   for (i=0; i<NUMLONGAS; i++)
+      task_create (&longa[i], Longa, NULL) ;
+   for (i=0; i<NUMCURTAS; i++)
+      task_create (&curta[i], Curta, NULL) ;
+
+   for (i=0; i<NUMLONGAS; i++)
+      task_join (&longa[i]) ;
+   for (i=0; i<NUMCURTAS; i++)
+      task_join (&curta[i]) ;
+
+   printf ("\nretorno medio: curtas %d ms, longas %d ms\n",
+           retornoCurtas / NUMCURTAS, retornoLongas / NUMLONGAS) ;
+
+   printf ("main: fim\n");
+   exit (0);
+}
@@ -0,0 +1,64 @@
+// PingPongOS - PingPong Operating System
+
+// Teste do escalonador stride: NUMTASKS tarefas que só usam o processador,
+// com pesos 10, 20 e 30 (prioridades 11, 1 e -9), executam por DURACAO ms.
+// A fração do processador que cada uma recebe deve convergir para a fração
+// do seu peso no total.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define NUMTASKS 3
+#define DURACAO  10000
+
+task_t task[NUMTASKS] ;
+int prio[NUMTASKS] = {11, 1, -9} ;
+
+// corpo das tarefas: usa o processador até DURACAO ms
+void Body (void * arg)
+{
+   while (systime () < DURACAO) ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i, pesoTotal = 0, tempoTotal = 0 ;
+   double esperada, medida, erroMax = 0.0 ;
+
+   ppos_set_scheduler (PPOS_SCHED_STRIDE) ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   for (i=0; i<NUMTASKS; i++)
+   {
+      task_create (&task[i], Body, NULL) ;
+      task_setprio (&task[i], prio[i]) ;
+      pesoTotal += 21 - prio[i] ;
+   }
+
+   for (i=0; i<NUMTASKS; i++)
+      task_join (&task[i]) ;
+
+   for (i=0; i<NUMTASKS; i++)
+      tempoTotal += task[i].running_time ;
+
+   printf ("\n%6s %6s %12s %12s\n", "tarefa", "peso", "esperada (%)", "medida (%)") ;
+   for (i=0; i<NUMTASKS; i++)
+   {
+      esperada = 100.0 * (21 - prio[i]) / pesoTotal ;
+      medida   = 100.0 * task[i].running_time / tempoTotal ;
+      if (medida - esperada > erroMax)
+         erroMax = medida - esperada ;
+      if (esperada - medida > erroMax)
+         erroMax = esperada - medida ;
+      printf ("%6d %6d %12.2f %12.2f\n", task[i].id, 21 - prio[i], esperada, medida) ;
+   }
+   printf ("erro maximo: %.2f pontos percentuais\n", erroMax) ;
+
+   printf ("main: fim\n");
+   exit (0);
+}
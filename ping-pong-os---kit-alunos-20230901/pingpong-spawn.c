@@ -0,0 +1,105 @@
+// PingPongOS - PingPong Operating System
+
+// Teste dos descritores alocados pelo núcleo (task_spawn/task_release). Cria
+// NUMTASKS tarefas com task_spawn e devolve os descritores de metade delas
+// antes de terminarem (task_release logo após a criação) e da outra metade
+// depois (task_join e então task_release). Com todas terminadas, cria outras
+// NUMTASKS tarefas e confere que elas reaproveitam os descritores e os
+// identificadores das primeiras. Confere também os erros de task_release.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define NUMTASKS 40
+
+task_t *tarefa[NUMTASKS], *antigas[NUMTASKS], comum ;
+int idsAntigos[NUMTASKS] ;
+int terminadas = 0 ;
+
+void Corpo (void * arg)
+{
+   task_yield () ;
+   terminadas++ ;
+   task_exit (0) ;
+}
+
+// cria NUMTASKS tarefas; as pares são liberadas antes de terminar e as
+// ímpares depois do task_join
+int rodada ()
+{
+   int i, erros = 0 ;
+
+   terminadas = 0 ;
+   for (i=0; i<NUMTASKS; i++)
+   {
+      tarefa[i] = task_spawn (Corpo, NULL) ;
+      if (tarefa[i] == NULL)
+      {
+         printf ("main: task_spawn falhou\n") ;
+         exit (1) ;
+      }
+      if (i % 2 == 0 && task_release (tarefa[i]) < 0)
+         erros++ ;
+   }
+
+   for (i=1; i<NUMTASKS; i+=2)
+   {
+      task_join (tarefa[i]) ;
+      if (task_release (tarefa[i]) < 0)
+         erros++ ;
+   }
+
+   // as liberadas antes de terminar não podem ser esperadas com task_join
+   while (terminadas < NUMTASKS)
+      task_yield () ;
+   // o descritor da última a terminar volta ao núcleo no próximo despacho
+   task_yield () ;
+
+   return erros ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i, j, erros, ids = 0, descritores = 0 ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   erros = rodada () ;
+   for (i=0; i<NUMTASKS; i++)
+   {
+      antigas[i] = tarefa[i] ;
+      idsAntigos[i] = tarefa[i]->id ;
+   }
+
+   erros += rodada () ;
+   for (i=0; i<NUMTASKS; i++)
+      for (j=0; j<NUMTASKS; j++)
+      {
+         if (tarefa[i]->id == idsAntigos[j])
+            ids++ ;
+         if (tarefa[i] == antigas[j])
+            descritores++ ;
+      }
+
+   printf ("main: %d task_release falharam\n", erros) ;
+   printf ("main: %d de %d identificadores reaproveitados\n", ids, NUMTASKS) ;
+   printf ("main: %d de %d descritores reaproveitados\n", descritores, NUMTASKS) ;
+
+   // só os descritores do task_spawn podem ser liberados, uma única vez
+   task_create (&comum, Corpo, NULL) ;
+   printf ("main: task_release de tarefa do task_create: %d\n", task_release (&comum)) ;
+   task_join (&comum) ;
+   tarefa[0] = task_spawn (Corpo, NULL) ;
+   task_release (tarefa[0]) ;
+   printf ("main: segundo task_release: %d\n", task_release (tarefa[0])) ;
+
+   if (erros == 0 && ids == NUMTASKS && descritores == NUMTASKS)
+      printf ("main: descritores e identificadores reaproveitados, correto!\n") ;
+
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+   exit (0) ;
+}
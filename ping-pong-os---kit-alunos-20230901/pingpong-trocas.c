@@ -0,0 +1,71 @@
+// PingPongOS - PingPong Operating System
+
+// Teste de desempenho das trocas de contexto: duas tarefas (Ping e Pong)
+// devolvem o processador uma à outra muitas vezes; cada task_yield faz duas
+// trocas de contexto (tarefa -> dispatcher -> tarefa). O mesmo teste é
+// compilado com o swapcontext da glibc (pingpong-trocas) e com a troca
+// rápida (pingpong-trocas-rapida, -DFASTSWITCH), para comparação.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ppos.h"
+
+#define ROUNDS 200000
+
+task_t Ping, Pong ;
+
+// tempo monotônico em nanossegundos
+double agora ()
+{
+   struct timespec ts ;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts) ;
+   return (ts.tv_sec * 1e9 + ts.tv_nsec) ;
+}
+
+// corpo das threads
+void Body (void * arg)
+{
+   int i ;
+
+   for (i=0; i<ROUNDS; i++)
+      task_yield () ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   double t0, t1, trocas ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   // a main só volta ao processador quando Ping e Pong terminarem
+   task_set_eet (NULL, 99999) ;
+
+   task_create (&Ping, Body, NULL) ;
+   task_create (&Pong, Body, NULL) ;
+   task_set_eet (&Ping, 1000) ;
+   task_set_eet (&Pong, 1000) ;
+
+   t0 = agora () ;
+   task_join (&Ping) ;
+   task_join (&Pong) ;
+   t1 = agora () ;
+
+   // cada task_yield: tarefa -> dispatcher -> tarefa
+   trocas = 2.0 * 2 * ROUNDS ;
+
+#ifdef FASTSWITCH
+   printf ("troca de contexto: rapida\n") ;
+#else
+   printf ("troca de contexto: swapcontext\n") ;
+#endif
+   printf ("%.0f trocas em %.3f s: %.0f trocas/s, %.0f ns por troca\n",
+           trocas, (t1 - t0) / 1e9, trocas / ((t1 - t0) / 1e9), (t1 - t0) / trocas) ;
+
+   printf ("main: fim\n");
+   exit (0);
+}
@@ -1,4 +1,6 @@
+#define _GNU_SOURCE //habilitar mmap anônimo e dlsym(RTLD_NEXT, ...)
 #define _XOPEN_SOURCE 700 //habilitar o struct sigaction
+#include <pthread.h> //antes do ppos.h, que proíbe as funções de threads às aplicações
 #include "ppos.h"
 #include "ppos-core-globals.h"
 #include "ppos_data.h"
@@ -10,17 +12,2984 @@
 
 #include <signal.h>
 #include <sys/time.h>
+#include <time.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include <stdatomic.h>
 
 
-#define QUANTUM 20; //cada tarefa de usuario tem um quantum de 20ms 
+#define QUANTUM 20 //cada tarefa de usuario tem um quantum de 20ms (veja ppos_set_quantum)
+
+// Compilando com -DTICKLESS o temporizador deixa de disparar a cada 1 ms:
+// ele é programado para um único disparo no próximo evento de interesse
+// (fim do quantum da tarefa corrente ou despertar de uma tarefa adormecida)
+// e o tempo decorrido é medido com o relógio monotônico do sistema. Nesse
+// modo systime() avança aos saltos, somente nos disparos e nas trocas de
+// contexto.
+//
+// Compilando com -DFASTSWITCH as trocas de contexto do núcleo deixam de usar
+// o swapcontext da glibc, que faz uma chamada de sistema (rt_sigprocmask) a
+// cada troca: veja a seção "troca de contexto rápida" logo abaixo.
 
 
 // estrutura que define um tratador de sinal (deve ser global ou static)
 struct sigaction action;
 
-// estrutura de inicialização to timer
-struct itimerval timer;
+// estrutura de inicialização to timer
+struct itimerval timer;
+
+// o núcleo (libppos_static.a) reserva os descritores da main e do dispatcher
+// com o tamanho original de task_t; como o TCB ganhou campos em ppos_data.h,
+// eles são redefinidos aqui com o tamanho atual
+task_t _taskMain, _taskDisp;
+
+// o núcleo lê tempoRestante na posição do ppos_data.h original, e os campos
+// consultados a cada despacho ocupam a primeira linha de cache adicionada
+_Static_assert (offsetof (task_t, tarefaCritica) == 0x400, "task_t inesperado");
+_Static_assert (offsetof (task_t, tempoRestante) == 0x408, "task_t inesperado");
+_Static_assert (offsetof (task_t, posicaoRoda) + sizeof (task_t **) <= 0x440, "task_t inesperado");
+
+// o before_task_create desabilita a preempção até o after_task_create, que
+// restaura o estado guardado aqui; sem memória para a pilha, o task_create do
+// núcleo retorna sem chamar o after_task_create, e quem restaura é o
+// task_create_adapt
+unsigned char preempcaoCriacao = 1;
+int criandoTarefa = 0;  //1 entre o before_task_create e o fim da criação
+
+
+#ifdef FASTSWITCH
+
+/*
+Troca de contexto rápida. O task_switch do núcleo (libppos_static.a) chama
+swapcontext(&atual->context, &proxima->context); definindo swapcontext aqui,
+o ligador resolve essa chamada para esta versão em vez da versão da glibc.
+Como a troca acontece sempre numa chamada de função, basta salvar os
+registradores que a ABI manda preservar (callee-saved), a pilha e o endereço
+de retorno, sem mexer na máscara de sinais.
+
+Os valores são guardados nas mesmas posições do ucontext_t em que a glibc os
+coloca, então um contexto recém-criado pelo task_create (getcontext +
+makecontext da glibc) é restaurado da mesma forma que um contexto salvo aqui:
+o argumento da função da tarefa vem junto (rdi no x86-64, x0 no aarch64).
+Em outras arquiteturas continua valendo o swapcontext da glibc, como se o
+sistema fosse compilado sem -DFASTSWITCH.
+
+A máscara de sinais só importa quando a troca sai de dentro do tratador,
+onde o SIGALRM está bloqueado: o tratador libera o sinal antes da preempção
+(veja tratador()). Nas demais seções críticas o núcleo já usa a variável
+preemption em vez da máscara de sinais.
+*/
+#if defined(__x86_64__)
+
+//posições no ucontext_t (layout da glibc)
+_Static_assert (offsetof (ucontext_t, uc_mcontext) == 40, "ucontext_t inesperado");
+_Static_assert (sizeof (gregset_t) == 23 * 8, "ucontext_t inesperado");
+_Static_assert (offsetof (ucontext_t, __fpregs_mem) == 424, "ucontext_t inesperado");
+
+__asm__ (
+    ".pushsection .text\n"
+    ".globl swapcontext\n"
+    ".type swapcontext, @function\n"
+    "swapcontext:\n"
+    //salva o contexto atual em *rdi: callee-saved, pilha e retorno
+    "    movq (%rsp), %r8\n"
+    "    leaq 8(%rsp), %r9\n"
+    "    movq %rbx, 128(%rdi)\n"
+    "    movq %rbp, 120(%rdi)\n"
+    "    movq %r12, 72(%rdi)\n"
+    "    movq %r13, 80(%rdi)\n"
+    "    movq %r14, 88(%rdi)\n"
+    "    movq %r15, 96(%rdi)\n"
+    "    movq %r9, 160(%rdi)\n"
+    "    movq %r8, 168(%rdi)\n"
+    //controle da FPU e do SSE também são preservados pela ABI
+    "    leaq 424(%rdi), %rcx\n"
+    "    movq %rcx, 224(%rdi)\n"
+    "    fnstcw (%rcx)\n"
+    "    stmxcsr 24(%rcx)\n"
+    //restaura o contexto *rsi
+    "    movq 224(%rsi), %rcx\n"
+    "    fldcw (%rcx)\n"
+    "    ldmxcsr 24(%rcx)\n"
+    "    movq 160(%rsi), %rsp\n"
+    "    movq 128(%rsi), %rbx\n"
+    "    movq 120(%rsi), %rbp\n"
+    "    movq 72(%rsi), %r12\n"
+    "    movq 80(%rsi), %r13\n"
+    "    movq 88(%rsi), %r14\n"
+    "    movq 96(%rsi), %r15\n"
+    //argumentos de um contexto criado pelo makecontext
+    "    movq 104(%rsi), %rdi\n"
+    "    movq 136(%rsi), %rdx\n"
+    "    movq 152(%rsi), %rcx\n"
+    "    movq 40(%rsi), %r8\n"
+    "    movq 48(%rsi), %r9\n"
+    "    movq 168(%rsi), %r10\n"
+    "    movq 112(%rsi), %rsi\n"
+    //fim da troca: a partir daqui a tarefa que entra pode ser preemptada
+    "    movl $0, trocandoContexto(%rip)\n"
+    "    xorl %eax, %eax\n"
+    "    jmp *%r10\n"
+    ".size swapcontext, .-swapcontext\n"
+    ".popsection\n"
+);
+
+#elif defined(__aarch64__)
+
+//posições no ucontext_t (layout da glibc): regs[n] em 184 + 8n, sp em 432,
+//pc em 440; d8-d15 ficam na área fpsimd de __reserved (v8 em 608)
+_Static_assert (offsetof (ucontext_t, uc_mcontext) == 176, "ucontext_t inesperado");
+_Static_assert (offsetof (mcontext_t, __reserved) == 288, "ucontext_t inesperado");
+
+__asm__ (
+    ".pushsection .text\n"
+    ".globl swapcontext\n"
+    ".type swapcontext, %function\n"
+    "swapcontext:\n"
+    //salva o contexto atual em *x0: callee-saved, pilha e retorno
+    "    stp x19, x20, [x0, #336]\n"
+    "    stp x21, x22, [x0, #352]\n"
+    "    stp x23, x24, [x0, #368]\n"
+    "    stp x25, x26, [x0, #384]\n"
+    "    stp x27, x28, [x0, #400]\n"
+    "    stp x29, x30, [x0, #416]\n"
+    "    str xzr, [x0, #184]\n"
+    "    mov x9, sp\n"
+    "    str x9, [x0, #432]\n"
+    "    str x30, [x0, #440]\n"
+    "    add x9, x0, #608\n"
+    "    str d8, [x9, #0]\n"
+    "    str d9, [x9, #16]\n"
+    "    str d10, [x9, #32]\n"
+    "    str d11, [x9, #48]\n"
+    "    str d12, [x9, #64]\n"
+    "    str d13, [x9, #80]\n"
+    "    str d14, [x9, #96]\n"
+    "    str d15, [x9, #112]\n"
+    //restaura o contexto *x1
+    "    add x9, x1, #608\n"
+    "    ldr d8, [x9, #0]\n"
+    "    ldr d9, [x9, #16]\n"
+    "    ldr d10, [x9, #32]\n"
+    "    ldr d11, [x9, #48]\n"
+    "    ldr d12, [x9, #64]\n"
+    "    ldr d13, [x9, #80]\n"
+    "    ldr d14, [x9, #96]\n"
+    "    ldr d15, [x9, #112]\n"
+    "    ldp x19, x20, [x1, #336]\n"
+    "    ldp x21, x22, [x1, #352]\n"
+    "    ldp x23, x24, [x1, #368]\n"
+    "    ldp x25, x26, [x1, #384]\n"
+    "    ldp x27, x28, [x1, #400]\n"
+    "    ldp x29, x30, [x1, #416]\n"
+    "    ldr x9, [x1, #432]\n"
+    "    mov sp, x9\n"
+    //argumento de um contexto criado pelo makecontext (0 num contexto salvo)
+    "    ldr x0, [x1, #184]\n"
+    "    ldr x16, [x1, #440]\n"
+    //fim da troca: a partir daqui a tarefa que entra pode ser preemptada
+    "    adrp x9, trocandoContexto\n"
+    "    str wzr, [x9, #:lo12:trocandoContexto]\n"
+    "    br x16\n"
+    ".size swapcontext, .-swapcontext\n"
+    ".popsection\n"
+);
+
+#else
+
+//nas demais arquiteturas vale o swapcontext da glibc
+#undef FASTSWITCH
+
+#endif
+
+//sinal que precisa ser liberado ao trocar de tarefa dentro do tratador
+sigset_t sinaisTemporizador;
+
+#endif
+
+
+/*
+O task_switch do núcleo atualiza taskExec antes de trocar de contexto, e a
+troca (swapcontext) só termina depois de restaurar a pilha e os registradores
+da tarefa que entra. Um disparo do temporizador nesse intervalo não pode
+preemptar: taskExec ainda não é quem está executando, e salvar o contexto
+dela sobrescreveria o contexto que está sendo restaurado. A flag é ligada no
+before_task_switch e a troca rápida a desliga ao terminar; com o swapcontext
+da glibc não há como saber quando a troca termina, então o tratador a desliga
+a cada disparo e só preempta se nenhuma troca começou desde o disparo anterior.
+*/
+volatile int trocandoContexto = 0;
+
+//devolve 1 se uma troca de contexto pode estar em andamento neste disparo
+int trocaEmAndamento(){
+    int emAndamento = trocandoContexto;
+
+#ifndef FASTSWITCH
+    trocandoContexto = 0;
+#endif
+    return emAndamento;
+}
+
+
+/*
+Pilhas das tarefas. O task_create do núcleo aloca com malloc uma pilha de
+STACKSIZE bytes, monta o contexto nela com makecontext e o dispatcher a
+libera com free quando a tarefa termina (freeTask). Definindo makecontext
+aqui, a pilha é trocada antes de o contexto ser montado por outra, tirada de
+um conjunto de pilhas livres separadas por classe de tamanho. Cada pilha é
+mapeada com mmap e tem uma página de guarda (PROT_NONE) logo abaixo dela,
+de modo que um estouro de pilha gera SIGSEGV em vez de corromper a memória
+vizinha. Quando a tarefa termina, a pilha volta para a lista da sua classe
+e é reaproveitada pela próxima tarefa criada, sem novas faltas de página.
+Um pedido maior que a maior classe (task_create_ex) recebe uma pilha
+mapeada sob medida, desfeita quando a tarefa termina. Só o makecontext
+chamado pelo task_create troca a pilha; nos demais ele é o da glibc.
+*/
+#define PILHA_CLASSES 4
+
+size_t tamanhoClasse[PILHA_CLASSES] = {8192, 32768, 131072, 1048576};
+
+//primeira pilha livre de cada classe; o encadeamento fica no topo de cada
+//pilha, a página que o makecontext já tocou, para não trazer outras páginas
+//para a memória
+void *pilhasLivres[PILHA_CLASSES];
+
+//pilha da última tarefa que terminou: ela ainda está em uso até a troca para
+//o dispatcher, então só é devolvida depois (pilhaDevolve)
+void *pilhaTerminada = NULL;
+size_t tamanhoPilhaTerminada = 0;
+
+//pilha já alocada pelo task_create_ex para a tarefa em criação (NULL: o
+//makecontext usa uma pilha do tamanho padrão)
+void *pilhaPedida = NULL;
+size_t tamanhoPilhaPedida = 0;
+
+//makecontext da glibc, chamado depois da troca de pilha
+void (*makecontextGlibc)(ucontext_t *, void (*)(void), int, ...) = NULL;
+
+//encadeamento guardado no topo de uma pilha livre
+typedef struct pilhaLivre_t {
+    void *proxima;
+} pilhaLivre_t;
+
+
+//devolve o encadeamento de uma pilha livre (no topo da pilha)
+pilhaLivre_t *pilhaEncadeamento(void *pilha, size_t tamanho){
+    return (pilhaLivre_t *) ((char *) pilha + tamanho) - 1;
+}
+
+
+//devolve a menor classe com pilhas de pelo menos tamanho bytes
+int pilhaClasse(size_t tamanho){
+    int classe = 0;
+
+    while(classe < PILHA_CLASSES - 1 && tamanhoClasse[classe] < tamanho)
+        classe++;
+
+    return classe;
+}
+
+
+//mapeia uma nova pilha de tamanho bytes, com a página de guarda abaixo dela
+void *pilhaMapeia(size_t tamanho){
+    size_t pagina = sysconf(_SC_PAGESIZE);
+    char *area;
+
+    area = mmap(NULL, pagina + tamanho, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if(area == MAP_FAILED){
+        perror("Erro ao mapear a pilha da tarefa: ");
+        return NULL;
+    }
+
+    if(mprotect(area, pagina, PROT_NONE) < 0){
+        perror("Erro ao proteger a pilha da tarefa: ");
+        munmap(area, pagina + tamanho);
+        return NULL;
+    }
+
+    return area + pagina;
+}
+
+
+/*
+Devolve uma pilha de pelo menos tamanho bytes, informando em tamanhoReal o
+tamanho que ela tem. Uma pilha livre de classe maior é aproveitada antes de
+mapear uma nova, para que a memória já residente seja reusada.
+*/
+void *pilhaAloca(size_t tamanho, size_t *tamanhoReal){
+    int classe = pilhaClasse(tamanho);
+    int k;
+
+    //maior que a maior classe: pilha sob medida (em páginas inteiras)
+    if(tamanho > tamanhoClasse[PILHA_CLASSES - 1]){
+        size_t pagina = sysconf(_SC_PAGESIZE);
+
+        *tamanhoReal = (tamanho + pagina - 1) / pagina * pagina;
+        return pilhaMapeia(*tamanhoReal);
+    }
+
+    for(k = classe; k < PILHA_CLASSES; k++){
+        if(pilhasLivres[k] != NULL){
+            void *pilha = pilhasLivres[k];
+
+            pilhasLivres[k] = pilhaEncadeamento(pilha, tamanhoClasse[k])->proxima;
+            *tamanhoReal = tamanhoClasse[k];
+            return pilha;
+        }
+    }
+
+    *tamanhoReal = tamanhoClasse[classe];
+    return pilhaMapeia(tamanhoClasse[classe]);
+}
+
+
+//devolve a pilha à lista livre da sua classe; uma pilha sob medida é desfeita
+void pilhaGuarda(void *pilha, size_t tamanho){
+    int classe;
+
+    if(tamanho > tamanhoClasse[PILHA_CLASSES - 1]){
+        size_t pagina = sysconf(_SC_PAGESIZE);
+
+        munmap((char *) pilha - pagina, pagina + tamanho);
+        return;
+    }
+
+    classe = pilhaClasse(tamanho);
+    pilhaEncadeamento(pilha, tamanho)->proxima = pilhasLivres[classe];
+    pilhasLivres[classe] = pilha;
+}
+
+
+//devolve a pilha da última tarefa que terminou; só pode ser chamada fora
+//dessa pilha (p.ex. pelo dispatcher)
+void pilhaDevolve(){
+    if(pilhaTerminada == NULL)
+        return;
+
+    pilhaGuarda(pilhaTerminada, tamanhoPilhaTerminada);
+    pilhaTerminada = NULL;
+}
+
+
+/*
+Chamada pelo task_create do núcleo depois do malloc da pilha: troca essa
+pilha pela do task_create_ex ou por uma do conjunto e monta o contexto com o
+makecontext da glibc. Fora do task_create (criandoTarefa), a pilha de quem
+chama não é tocada. Os argumentos são repassados à glibc, até
+MAKECONTEXT_ARGS (o núcleo passa um só, o arg da tarefa).
+*/
+#define MAKECONTEXT_ARGS 6
+
+void makecontext(ucontext_t *ucp, void (*func)(void), int argc, ...){
+    size_t tamanhoReal;
+    void *pilha, *arg[MAKECONTEXT_ARGS] = {NULL};
+    va_list args;
+    int i;
+
+    if(makecontextGlibc == NULL)
+        makecontextGlibc = dlsym(RTLD_NEXT, "makecontext");
+
+    if(argc > MAKECONTEXT_ARGS)
+        argc = MAKECONTEXT_ARGS;
+    va_start(args, argc);
+    for(i = 0; i < argc; i++)
+        arg[i] = va_arg(args, void *);
+    va_end(args);
+
+    if(criandoTarefa){
+        if(pilhaPedida != NULL){
+            pilha = pilhaPedida;
+            tamanhoReal = tamanhoPilhaPedida;
+            pilhaPedida = NULL;
+        }
+        else
+            //sem uma pilha do conjunto, a tarefa fica com a pilha do malloc
+            pilha = pilhaAloca(ucp->uc_stack.ss_size, &tamanhoReal);
+
+        if(pilha != NULL){
+            free(ucp->uc_stack.ss_sp);
+            ucp->uc_stack.ss_sp = pilha;
+            ucp->uc_stack.ss_size = tamanhoReal;
+        }
+    }
+
+    makecontextGlibc(ucp, func, argc, arg[0], arg[1], arg[2], arg[3], arg[4], arg[5]);
+}
+
+
+/*
+Política de escalonamento, escolhida antes do ppos_init (ppos_set_scheduler
+ou a variável de ambiente PPOS_SCHED) e fixa daí em diante. Todas as
+políticas usam o mesmo heap de prontas: cada uma só define a chave de
+ordenação das tarefas, a fatia de tempo de cada tarefa e o que acontece
+quando essa fatia se esgota.
+*/
+typedef struct {
+    const char *nome;
+    long (*chave)(task_t *task);            //a tarefa de menor chave é despachada primeiro
+    int (*quantum)(task_t *task);           //fatia de tempo da tarefa, em ms
+    void (*quantumEsgotado)(task_t *task);  //chamada pelo tratador antes de preemptar (pode ser NULL)
+    void (*antesEscolha)();                 //chamada pelo scheduler antes de consultar o heap (pode ser NULL)
+    void (*pronta)(task_t *task);           //chamada quando a tarefa entra no heap (pode ser NULL)
+    void (*deixaProntas)(task_t *task);     //chamada quando a tarefa sai do heap (pode ser NULL)
+    void (*usouProcessador)(task_t *task, int tempo); //chamada quando a tarefa deixa o processador,
+                                                      //com o tempo usado em ms (pode ser NULL)
+    int preemptiva;  //1 se uma tarefa pronta de chave menor preempta a tarefa corrente
+} politica_t;
+
+//política em uso (a padrão é definida no before_ppos_init)
+politica_t *politica = NULL;
+
+
+//as tarefas de tempo real com orçamento (veja task_set_deadline) ficam à
+//frente de todas as demais, ordenadas pelo prazo (EDF)
+#define CHAVE_TEMPO_REAL (LONG_MIN / 2)
+#define CHAVE_EH_TEMPO_REAL(chave) ((chave) < CHAVE_TEMPO_REAL / 2)
+
+//devolve 1 se a chave a vem antes da chave b; entre duas chaves de tempo
+//real, cujos 32 bits baixos são o prazo, compara os prazos como instantes,
+//(int)(a - b), para que um prazo após a volta do systemTime venha depois
+int chaveAntes(long a, long b){
+    if(CHAVE_EH_TEMPO_REAL(a) && CHAVE_EH_TEMPO_REAL(b))
+        return (int) ((unsigned int) a - (unsigned int) b) < 0;
+    return a < b;
+}
+
+//tarefas de tempo real, encadeadas por proxTempoReal
+task_t *listaTempoReal = NULL;
+
+
+//chave da tarefa no heap de prontas; o dono de mutexes disputados vale
+//tanto quanto a tarefa mais urgente que os espera (veja herancaRecalcula)
+long chaveTarefa(task_t *task){
+    long chave;
+
+    if(task->tempoReal && task->orcamentoRestante > 0)
+        chave = CHAVE_TEMPO_REAL + task->prazoAbsoluto;
+    else
+        chave = politica->chave(task);
+
+    return chaveAntes(task->chaveHerdada, chave) ? task->chaveHerdada : chave;
+}
+
+
+/*
+Grupos de tarefas. Cada grupo soma o tempo de processador e de espera das
+suas tarefas (e dos grupos descendentes) e pode ter um limite de banda:
+quota ms de processador a cada período. O tratador cobra o tempo da tarefa
+corrente de todos os grupos acima dela; o grupo que esgota a quota fica
+estrangulado até o início do próximo período, e as suas tarefas prontas
+ficam retidas numa lista do grupo, fora do heap de prontas, para que a
+escolha da próxima tarefa não dependa delas. A retenção é preguiçosa: a
+tarefa que volta ao heap (task_yield, task_resume) é retida na entrada, e a
+que já estava nele é retida quando chega ao topo (scheduler).
+As cotas (shares) dividem o processador entre os grupos na política CFS,
+como no escalonamento em grupos do Linux: o peso efetivo de uma tarefa é o
+seu peso na proporção do peso ativo do seu grupo, multiplicado pelas cotas
+do grupo, e assim por diante até o nível mais alto, onde os grupos competem
+com as tarefas sem grupo. Todas as tarefas do CFS ficam num único heap, e o
+peso efetivo só é usado para cobrar o tempo virtual.
+*/
+
+//peso de cada prioridade, de -20 a +20 (a tabela do Linux, em que cada nível
+//de prioridade vale ~25% de processador; a prioridade +20 foi acrescentada)
+int pesoPrioridade[41] = {
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */  9548,  7620,  6100,  4904,  3906,
+    /*  -5 */  3121,  2501,  1991,  1586,  1277,
+    /*   0 */  1024,   820,   655,   526,   423,
+    /*   5 */   335,   272,   215,   172,   137,
+    /*  10 */   110,    87,    70,    56,    45,
+    /*  15 */    36,    29,    23,    18,    15,
+    /*  20 */    12,
+};
+
+//grupos com limite de banda, encadeados por proxComLimite
+taskgroup_t *gruposComLimite = NULL;
+
+//menor proximaRecarga entre os grupos com limite de banda
+unsigned int proximaRecargaGrupos = UINT_MAX;
+
+//número de grupos estrangulados (sem nenhum, o scheduler não procura retidas)
+int gruposEstrangulados = 0;
+
+
+//conta a tarefa como pronta ou executando no seu grupo e nos grupos acima:
+//um grupo que passa a ter tarefas ativas soma as suas cotas ao grupo pai
+void grupoAtiva(task_t *task){
+    taskgroup_t *grupo;
+    long peso;
+
+    if(task->grupo == NULL || task->ativaNoGrupo)
+        return;
+
+    task->ativaNoGrupo = 1;
+    task->pesoNoGrupo = peso = pesoPrioridade[task->prioridade + 20];
+    for(grupo = task->grupo; grupo != NULL; grupo = grupo->pai){
+        grupo->pesoAtivo += peso;
+        peso = (grupo->ativas++ == 0) ? grupo->cotas : 0;
+    }
+}
+
+
+//deixa de contar a tarefa como ativa (bloqueada, retida ou terminando)
+void grupoDesativa(task_t *task){
+    taskgroup_t *grupo;
+    long peso;
+
+    if(task->grupo == NULL || !task->ativaNoGrupo)
+        return;
+
+    task->ativaNoGrupo = 0;
+    peso = task->pesoNoGrupo;
+    for(grupo = task->grupo; grupo != NULL; grupo = grupo->pai){
+        grupo->pesoAtivo -= peso;
+        peso = (--grupo->ativas == 0) ? grupo->cotas : 0;
+    }
+}
+
+
+//peso da tarefa na proporção dos grupos acima dela (CFS)
+long grupoPesoEfetivo(task_t *task){
+    taskgroup_t *grupo;
+    long peso;
+
+    peso = task->ativaNoGrupo ? task->pesoNoGrupo : pesoPrioridade[task->prioridade + 20];
+    for(grupo = task->grupo; grupo != NULL && grupo->pesoAtivo > 0; grupo = grupo->pai)
+        peso = peso * grupo->cotas / grupo->pesoAtivo;
+
+    return (peso > 0) ? peso : 1;
+}
+
+
+//devolve o grupo estrangulado mais próximo acima da tarefa (ou NULL)
+taskgroup_t *grupoEstrangulador(task_t *task){
+    taskgroup_t *grupo;
+
+    if(gruposEstrangulados == 0)
+        return NULL;
+
+    for(grupo = task->grupo; grupo != NULL; grupo = grupo->pai)
+        if(grupo->estrangulado)
+            return grupo;
+    return NULL;
+}
+
+
+//retém uma tarefa pronta (fora do heap) no grupo estrangulado; o tempo
+//retida conta como espera. A tarefa corrente que é retida ao ceder o
+//processador só é desativada na troca de contexto (before_task_switch)
+void grupoEstaciona(task_t *task, taskgroup_t *grupo){
+    task->estacionadaEm = grupo;
+    task->proxEstacionada = grupo->estacionadas;
+    grupo->estacionadas = task;
+    task->entradaProntas = systemTime;
+
+    if(task != taskExec)
+        grupoDesativa(task);
+}
+
+
+//soma o tempo de espera de uma tarefa aos seus grupos
+void grupoEspera(task_t *task, int espera){
+    taskgroup_t *grupo;
+
+    for(grupo = task->grupo; grupo != NULL; grupo = grupo->pai)
+        grupo->tempoDeEspera += espera;
+}
+
+
+//libera uma tarefa retida (sem devolvê-la ao heap), contabilizando a espera
+void grupoDesestaciona(task_t *task){
+    task_t **ant;
+    int espera;
+
+    if(task->estacionadaEm == NULL)
+        return;
+
+    for(ant = &task->estacionadaEm->estacionadas; *ant != NULL; ant = &(*ant)->proxEstacionada){
+        if(*ant == task){
+            *ant = task->proxEstacionada;
+            break;
+        }
+    }
+    task->estacionadaEm = NULL;
+    task->proxEstacionada = NULL;
+
+    espera = systemTime - task->entradaProntas;
+    task->tempoDeEspera += espera;
+    grupoEspera(task, espera);
+}
+
+
+//cobra dos grupos da tarefa corrente o tempo de processador usado; o grupo
+//que esgota a quota é estrangulado, e o quantum da tarefa (de usuário) é
+//zerado para que ela ceda o processador
+void grupoCobra(task_t *task, int decorrido){
+    taskgroup_t *grupo;
+
+    for(grupo = task->grupo; grupo != NULL; grupo = grupo->pai){
+        grupo->running_time += decorrido;
+
+        if(grupo->quota > 0 && !grupo->estrangulado){
+            grupo->consumido += decorrido;
+            if(grupo->consumido >= grupo->quota){
+                grupo->estrangulado = 1;
+                gruposEstrangulados++;
+            }
+        }
+
+        if(grupo->estrangulado && task->tarefaCritica == 0)
+            task->quantum = 0;
+    }
+}
+
+
+//menor quota restante entre os grupos da tarefa, em ms (INT_MAX se nenhum
+//tem limite de banda)
+int grupoFolga(task_t *task){
+    taskgroup_t *grupo;
+    int folga = INT_MAX;
+
+    for(grupo = task->grupo; grupo != NULL; grupo = grupo->pai){
+        if(grupo->estrangulado)
+            return 0;
+        if(grupo->quota > 0 && grupo->quota - grupo->consumido < folga)
+            folga = grupo->quota - grupo->consumido;
+    }
+    return folga;
+}
+
+
+/*
+Heap binário (mínimo) com as tarefas prontas, ordenado pela chave da política.
+Ele espelha a readyQueue mantida pelo núcleo: as tarefas entram nos mesmos
+pontos em que o núcleo as coloca na fila de prontas (task_create, task_resume,
+task_yield) e saem quando são despachadas ou suspensas. Assim o scheduler()
+escolhe a próxima tarefa em O(1) e as atualizações custam O(log n).
+Entrada e saída do heap também delimitam o tempo de espera de cada tarefa.
+O vetor é indexado a partir de 1, para que posicaoHeap == 0 (valor inicial
+de um TCB zerado) signifique "fora do heap".
+Cada entrada guarda uma cópia da chave de ordenação da tarefa, para que as
+comparações feitas ao subir e descer no heap não precisem ler os TCBs.
+*/
+typedef struct {
+    long chave;                 //cópia da chave da tarefa na política em uso
+    unsigned long ordemChegada; //ordem de chegada, usada no desempate
+    task_t *task;
+} entradaHeap_t;
+
+entradaHeap_t *heapProntas = NULL;
+int tamanhoHeap = 0;
+int capacidadeHeap = 0;
+
+//contador usado para desempatar tarefas com a mesma chave pela ordem de
+//chegada, como fazia a busca linear na readyQueue
+unsigned long contadorChegada = 0;
+
+//as tarefas do heap também ficam numa lista pela ordem de entrada, que é a
+//de entradaProntas: a mais antiga, no início, é achada em O(1)
+task_t *prontaMaisAntiga = NULL, *prontaMaisRecente = NULL;
+
+
+//devolve 1 se a entrada a deve ser escalonada antes da entrada b
+int heapPrecede(entradaHeap_t *a, entradaHeap_t *b){
+    if(a->chave != b->chave)
+        return chaveAntes(a->chave, b->chave);
+    return a->ordemChegada < b->ordemChegada;
+}
+
+
+//coloca a entrada na posição pos do heap, atualizando o índice da tarefa
+void heapColoca(entradaHeap_t entrada, int pos){
+    heapProntas[pos] = entrada;
+    entrada.task->posicaoHeap = pos;
+}
+
+
+//sobe a entrada da posição pos até restaurar a propriedade do heap
+void heapSobe(int pos){
+    entradaHeap_t entrada = heapProntas[pos];
+
+    while(pos > 1 && heapPrecede(&entrada, &heapProntas[pos / 2])){
+        heapColoca(heapProntas[pos / 2], pos);
+        pos = pos / 2;
+    }
+    heapColoca(entrada, pos);
+}
+
+
+//desce a entrada da posição pos até restaurar a propriedade do heap
+void heapDesce(int pos){
+    entradaHeap_t entrada = heapProntas[pos];
+    int filho;
+
+    while((filho = 2 * pos) <= tamanhoHeap){
+        //escolhe o filho de maior prioridade
+        if(filho < tamanhoHeap && heapPrecede(&heapProntas[filho + 1], &heapProntas[filho]))
+            filho++;
+
+        if(!heapPrecede(&heapProntas[filho], &entrada))
+            break;
+
+        heapColoca(heapProntas[filho], pos);
+        pos = filho;
+    }
+    heapColoca(entrada, pos);
+}
+
+
+//insere uma tarefa pronta no heap (não faz nada se ela já estiver nele)
+void heapInsere(task_t *task){
+    unsigned char preempcaoAnterior = preemption;
+    taskgroup_t *estrangulador;
+
+    if(task == NULL || task->posicaoHeap != 0 || task->estacionadaEm != NULL)
+        return;
+
+    PPOS_PREEMPT_DISABLE
+
+    //a tarefa de um grupo estrangulado fica retida até o próximo período
+    estrangulador = grupoEstrangulador(task);
+    if(estrangulador != NULL){
+        grupoEstaciona(task, estrangulador);
+        preemption = preempcaoAnterior;
+        return;
+    }
+    grupoAtiva(task);
+
+    //o vetor cresce dobrando de tamanho (a posição 0 não é usada)
+    if(tamanhoHeap + 1 >= capacidadeHeap){
+        int novaCapacidade = (capacidadeHeap == 0) ? 64 : 2 * capacidadeHeap;
+        entradaHeap_t *novoHeap = realloc(heapProntas, novaCapacidade * sizeof(entradaHeap_t));
+
+        if(novoHeap == NULL){
+            perror("Erro ao alocar o heap de prontas: ");
+            exit(1);
+        }
+        heapProntas = novoHeap;
+        capacidadeHeap = novaCapacidade;
+    }
+
+    if(politica->pronta != NULL)
+        politica->pronta(task);
+
+    task->ordemChegada = contadorChegada++;
+    task->entradaProntas = systemTime;
+
+    task->proxPronta = NULL;
+    task->antPronta = prontaMaisRecente;
+    if(prontaMaisRecente != NULL)
+        prontaMaisRecente->proxPronta = task;
+    else
+        prontaMaisAntiga = task;
+    prontaMaisRecente = task;
+
+    tamanhoHeap++;
+    heapProntas[tamanhoHeap].chave = chaveTarefa(task);
+    heapProntas[tamanhoHeap].ordemChegada = task->ordemChegada;
+    heapProntas[tamanhoHeap].task = task;
+    heapSobe(tamanhoHeap);
+
+    preemption = preempcaoAnterior;
+}
+
+
+//retira uma tarefa do heap, qualquer que seja a sua posição
+void heapRemove(task_t *task){
+    unsigned char preempcaoAnterior = preemption;
+    int pos;
+
+    if(task == NULL || task->posicaoHeap == 0)
+        return;
+
+    PPOS_PREEMPT_DISABLE
+
+    pos = task->posicaoHeap;
+    task->posicaoHeap = 0;
+
+    if(politica->deixaProntas != NULL)
+        politica->deixaProntas(task);
+
+    //o tempo de espera é contabilizado de uma vez, na saída da fila de prontas
+    task->tempoDeEspera += systemTime - task->entradaProntas;
+    grupoEspera(task, systemTime - task->entradaProntas);
+
+    if(task->antPronta != NULL)
+        task->antPronta->proxPronta = task->proxPronta;
+    else
+        prontaMaisAntiga = task->proxPronta;
+    if(task->proxPronta != NULL)
+        task->proxPronta->antPronta = task->antPronta;
+    else
+        prontaMaisRecente = task->antPronta;
+
+    //a última tarefa do heap ocupa o lugar da removida
+    if(pos != tamanhoHeap){
+        task_t *ultima = heapProntas[tamanhoHeap].task;
+        heapColoca(heapProntas[tamanhoHeap], pos);
+        tamanhoHeap--;
+        heapSobe(pos);
+        heapDesce(ultima->posicaoHeap);
+    }
+    else{
+        tamanhoHeap--;
+    }
+
+    preemption = preempcaoAnterior;
+}
+
+
+//reposiciona no heap uma tarefa cuja chave foi alterada
+void heapAtualiza(task_t *task){
+    unsigned char preempcaoAnterior = preemption;
+
+    if(task == NULL || task->posicaoHeap == 0)
+        return;
+
+    PPOS_PREEMPT_DISABLE
+
+    heapProntas[task->posicaoHeap].chave = chaveTarefa(task);
+    heapSobe(task->posicaoHeap);
+    heapDesce(task->posicaoHeap);
+
+    preemption = preempcaoAnterior;
+}
+
+
+//recalcula a chave de todas as entradas e reconstrói o heap, em O(n)
+void heapReconstroi(){
+    int pos;
+
+    for(pos = 1; pos <= tamanhoHeap; pos++)
+        heapProntas[pos].chave = chaveTarefa(heapProntas[pos].task);
+
+    for(pos = tamanhoHeap / 2; pos >= 1; pos--)
+        heapDesce(pos);
+}
+
+
+/*
+Fatia de tempo adaptativa, das políticas de fatia fixa (SRTF e stride). Cada
+tarefa tem a sua fatia, entre quantumMinimo e quantumMaximo
+(ppos_set_quantum): a tarefa que esgota a fatia, limitada pelo processador,
+passa a receber o dobro, e troca menos de contexto; a que bloqueia antes do
+fim dela (E/S, semáforos, task_sleep) passa a receber a metade, e volta do
+bloqueio com a fatia nova inteira. A ordem continua vindo da política (no
+SRTF, a rajada curta prevista já põe a tarefa que bloqueia à frente das
+limitadas pelo processador), mas a política passa a ser preemptiva: a
+tarefa que acorda não espera o fim de uma fatia longa. Com os limites
+iguais (o padrão, QUANTUM) a fatia é fixa e nada muda.
+*/
+int quantumMinimo = QUANTUM;
+int quantumMaximo = QUANTUM;
+
+
+//fatia inicial de toda tarefa
+int fatiaInicial(){
+    if(QUANTUM < quantumMinimo)
+        return quantumMinimo;
+    if(QUANTUM > quantumMaximo)
+        return quantumMaximo;
+    return QUANTUM;
+}
+
+int fatiaQuantum(task_t *task){
+    return task->fatia;
+}
+
+//a tarefa esgotou a fatia: a próxima é o dobro
+void fatiaEsgotada(task_t *task){
+    task->fatia = (task->fatia * 2 < quantumMaximo) ? task->fatia * 2 : quantumMaximo;
+}
+
+//diferente de zero se a política corrente usa a fatia adaptativa
+int fatiaAdaptativa(){
+    return quantumMinimo != quantumMaximo && politica->quantumEsgotado == fatiaEsgotada;
+}
+
+//a tarefa bloqueou antes do fim da fatia: a próxima é a metade, já renovada
+void fatiaInterrompida(task_t *task){
+    if(!fatiaAdaptativa())
+        return;
+
+    task->fatia = (task->fatia / 2 > quantumMinimo) ? task->fatia / 2 : quantumMinimo;
+    task->quantum = task->fatia;
+}
+
+
+//diferente de zero se a tarefa que fica pronta pode tomar o processador da
+//corrente (política preemptiva, fatia adaptativa ou tarefas de tempo real)
+int politicaPreemptiva(){
+    return politica->preemptiva || fatiaAdaptativa() || listaTempoReal != NULL;
+}
+
+
+/*
+Devolve 1 se há uma tarefa pronta que deve tomar o processador da tarefa
+corrente: numa política preemptiva (ou com a fatia adaptativa), qualquer
+tarefa de chave menor; nas demais, só uma tarefa de tempo real. Uma tarefa
+cujo despertar venceu (de volta à sleepQueue) só entra no heap quando o
+dispatcher a acorda, então nesse caso também vale ceder o processador: o
+dispatcher a acorda e escolhe entre ela e a tarefa corrente.
+*/
+int prontaMaisUrgente(){
+    if(politicaPreemptiva() && sleepQueue != NULL)
+        return 1;
+
+    if(tamanhoHeap == 0 || !chaveAntes(heapProntas[1].chave, chaveTarefa(taskExec)))
+        return 0;
+
+    return politica->preemptiva || fatiaAdaptativa() || CHAVE_EH_TEMPO_REAL(heapProntas[1].chave);
+}
+
+
+/*
+Estimativa automática das rajadas de CPU. A cada vez que uma tarefa deixa o
+processador, a rajada observada (o running_time gasto desde o despacho)
+atualiza a previsão da próxima por média exponencial com peso 1/2:
+previsão = (rajada + previsão) / 2. O erro absoluto de cada previsão é
+acumulado e a sua média é informada quando a tarefa termina.
+*/
+#define RAJADA_INICIAL 10 //previsão da primeira rajada de uma tarefa, em ms
+
+
+//marca o início de uma rajada da tarefa que recebe o processador
+void rajadaInicia(task_t *task){
+    task->inicioRajada = task->running_time;
+}
+
+
+//encerra a rajada da tarefa que deixa o processador, atualizando a previsão;
+//devolve a duração da rajada (ou -1 se a tarefa não estava numa rajada)
+int rajadaTermina(task_t *task){
+    int rajada;
+
+    if(task->inicioRajada < 0)
+        return -1;
+
+    rajada = task->running_time - task->inicioRajada;
+    task->inicioRajada = -1;
+
+    task->erroPrevisao += abs(rajada - task->rajadaPrevista);
+    task->rajadas++;
+    task->rajadaPrevista = (rajada + task->rajadaPrevista) / 2;
+
+    return rajada;
+}
+
+
+/*
+SRTF: a tarefa de menor tempo restante (task_set_eet) é despachada primeiro,
+e todas as tarefas recebem a mesma fatia de tempo (ou a fatia adaptativa). Para uma tarefa sem
+task_set_eet o tempo restante é desconhecido, e vale a previsão da sua
+próxima rajada (como no SJF).
+
+Com o envelhecimento (ppos_set_aging), cada ms de espera na fila de prontas
+desconta taxaEnvelhecimento% de ms da chave da tarefa, para que uma tarefa
+longa não espere para sempre enquanto chegam tarefas curtas. Como todas as
+tarefas prontas envelhecem no mesmo ritmo, a ordem entre elas não muda com
+o tempo: a chave chave - taxa * (agora - entrada) ordena o heap do mesmo
+jeito que chave / taxa + entrada, que é fixa. O envelhecimento é então
+aplicado uma única vez, quando a tarefa entra no heap, sem percorrer a fila
+a cada tick.
+O envelhecimento não limita a espera: uma tarefa longa ainda fica atrás das
+curtas que chegam até chave / taxa ms depois dela. O limite (esperaMaxima) é
+imposto na escolha: a tarefa pronta que já esperou esperaMaxima ms passa à
+frente das demais, a mais antiga primeiro (a lista de prontas por ordem de
+entrada dá a mais antiga em O(1)). Só as tarefas de tempo real (EDF), cujos
+prazos dependem de passarem à frente, continuam antes dela. Uma tarefa que
+vence a espera com outra no processador aguarda a próxima escolha, que vem
+no máximo uma fatia depois.
+*/
+int taxaEnvelhecimento = 0;  //em %; 0 desliga o envelhecimento
+int esperaMaxima = 0;        //em ms; 0 indica sem limite
+
+long srtfChave(task_t *task){
+    long chave;
+
+    if(task->estimativaAutomatica)
+        chave = task->rajadaPrevista;
+    else
+        chave = task->tempoRestante;
+
+    if(taxaEnvelhecimento > 0){
+        chave = chave * 100 / taxaEnvelhecimento;
+
+        //a tarefa fora do heap (a corrente) não está esperando
+        chave += (task->posicaoHeap != 0) ? task->entradaProntas : systemTime;
+    }
+
+    return chave;
+}
+
+politica_t politicaSRTF = {
+    .nome = "srtf",
+    .chave = srtfChave,
+    .quantum = fatiaQuantum,
+    .quantumEsgotado = fatiaEsgotada,
+};
+
+//devolve a tarefa pronta mais antiga, se ela já esperou esperaMaxima ms no
+//SRTF (NULL se nenhuma)
+task_t *srtfEsperaVencida(){
+    if(politica != &politicaSRTF || esperaMaxima == 0 || prontaMaisAntiga == NULL
+       || (int) (systemTime - prontaMaisAntiga->entradaProntas) < esperaMaxima)
+        return NULL;
+
+    return prontaMaisAntiga;
+}
+
+
+/*
+MLFQ (filas multinível com realimentação): toda tarefa começa no nível 0,
+o de maior prioridade e menor fatia de tempo, e desce um nível a cada
+fatia esgotada; uma tarefa que bloqueia antes disso (E/S, task_sleep) fica
+no seu nível, e a fatia que lhe resta não é renovada, para que bloquear
+pouco antes do fim do quantum não a mantenha no topo. A cada
+MLFQ_REFORCO ms todas as tarefas voltam ao nível 0, para que as tarefas
+longas não passem fome. Dentro de um nível vale a prioridade estática
+(task_setprio) e, entre iguais, a ordem de chegada (round-robin).
+O reforço só recalcula as tarefas prontas; as demais são atualizadas ao
+serem consultadas (mlfqNivel), comparando a geração de reforço que viram.
+*/
+#define MLFQ_NIVEIS 4
+#define MLFQ_REFORCO 1500
+
+int quantumNivel[MLFQ_NIVEIS] = {10, 20, 40, 80};
+
+unsigned int geracaoReforco = 0;
+unsigned int ultimoReforco = 0;
+
+
+//devolve o nível da tarefa, aplicando um reforço que ela ainda não viu
+//(a tarefa volta ao nível 0 com a fatia de tempo desse nível)
+int mlfqNivel(task_t *task){
+    if(task->geracaoReforco != geracaoReforco){
+        task->geracaoReforco = geracaoReforco;
+        task->nivel = 0;
+        task->quantum = quantumNivel[0];
+    }
+    return task->nivel;
+}
+
+long mlfqChave(task_t *task){
+    return (long) mlfqNivel(task) * 64 + (task->prioridade + 20);
+}
+
+int mlfqQuantum(task_t *task){
+    return quantumNivel[mlfqNivel(task)];
+}
+
+void mlfqQuantumEsgotado(task_t *task){
+    if(mlfqNivel(task) < MLFQ_NIVEIS - 1)
+        task->nivel++;
+}
+
+void mlfqAntesEscolha(){
+    if(systemTime - ultimoReforco < MLFQ_REFORCO)
+        return;
+
+    ultimoReforco = systemTime;
+    geracaoReforco++;
+    heapReconstroi();
+}
+
+politica_t politicaMLFQ = {
+    .nome = "mlfq",
+    .chave = mlfqChave,
+    .quantum = mlfqQuantum,
+    .quantumEsgotado = mlfqQuantumEsgotado,
+    .antesEscolha = mlfqAntesEscolha,
+    .preemptiva = 1,
+};
+
+
+/*
+Stride (passo): cada tarefa recebe uma fração do processador proporcional ao
+seu peso, 21 - prioridade (task_setprio): de 1 (prioridade +20) a 41
+(prioridade -20). O passe da tarefa avança, a cada vez que ela deixa o
+processador, o tempo usado vezes o seu passo (STRIDE_UM / peso), e é
+despachada a tarefa de menor passe. O passe global é o da última tarefa
+despachada (o menor entre as prontas); uma tarefa que entra no heap com o
+passe atrasado (nova ou acordando) é trazida até ele, para que não acumule
+crédito enquanto não disputava o processador.
+*/
+#define STRIDE_UM (1L << 20)
+
+long passeGlobal = 0;
+
+
+long strideChave(task_t *task){
+    return task->passe;
+}
+
+void strideAntesEscolha(){
+    if(tamanhoHeap > 0 && !CHAVE_EH_TEMPO_REAL(heapProntas[1].chave)
+       && heapProntas[1].chave > passeGlobal)
+        passeGlobal = heapProntas[1].chave;
+}
+
+void stridePronta(task_t *task){
+    if(task->passe < passeGlobal)
+        task->passe = passeGlobal;
+}
+
+void strideUsouProcessador(task_t *task, int tempo){
+    task->passe += tempo * (STRIDE_UM / (21 - task->prioridade));
+}
+
+politica_t politicaStride = {
+    .nome = "stride",
+    .chave = strideChave,
+    .quantum = fatiaQuantum,
+    .quantumEsgotado = fatiaEsgotada,
+    .antesEscolha = strideAntesEscolha,
+    .pronta = stridePronta,
+    .usouProcessador = strideUsouProcessador,
+};
+
+
+/*
+CFS (escalonador completamente justo): a chave é o tempo virtual da tarefa,
+o running_time que ela usou ponderado pelo peso da sua prioridade
+(pesoPrioridade), ou pelo peso efetivo se ela estiver num grupo (veja
+grupoPesoEfetivo). A fatia de tempo não é fixa: as tarefas prontas dividem
+a latência alvo (CFS_LATENCIA) na proporção dos pesos, sem que a fatia
+caia abaixo de CFS_GRANULARIDADE; assim toda tarefa
+pronta volta ao processador em no máximo
+max(CFS_LATENCIA, n * CFS_GRANULARIDADE) ms. O tempo virtual mínimo avança
+com a tarefa despachada; uma tarefa nova entra nele, e uma que acorda
+entra no máximo meia latência atrás dele, para não monopolizar o
+processador com o crédito acumulado enquanto dormia.
+As tarefas são mantidas no mesmo heap das demais políticas, que tem as
+operações de que o CFS precisa (menor chave, inserção e remoção em
+O(log n)).
+*/
+#define CFS_LATENCIA 20
+#define CFS_GRANULARIDADE 2
+#define CFS_PESO_NORMAL 1024
+
+//tempo virtual mínimo, em ms * CFS_PESO_NORMAL (para não perder a fração)
+long tempoVirtualMinimo = 0;
+
+//soma dos pesos das tarefas no heap
+long pesoProntas = 0;
+
+
+long cfsChave(task_t *task){
+    return task->tempoVirtual;
+}
+
+int cfsQuantum(task_t *task){
+    long peso = pesoPrioridade[task->prioridade + 20];
+    long fatia = CFS_LATENCIA * peso / (pesoProntas + peso);
+
+    return (fatia < CFS_GRANULARIDADE) ? CFS_GRANULARIDADE : fatia;
+}
+
+void cfsAntesEscolha(){
+    if(tamanhoHeap > 0 && !CHAVE_EH_TEMPO_REAL(heapProntas[1].chave)
+       && heapProntas[1].chave > tempoVirtualMinimo)
+        tempoVirtualMinimo = heapProntas[1].chave;
+}
+
+void cfsPronta(task_t *task){
+    long minimo = tempoVirtualMinimo;
+
+    if(task->ativacoes > 0)
+        minimo -= (long) CFS_LATENCIA / 2 * CFS_PESO_NORMAL;
+    if(task->tempoVirtual < minimo)
+        task->tempoVirtual = minimo;
+
+    //o peso é guardado porque a prioridade pode mudar enquanto a tarefa está no heap
+    task->pesoProntas = pesoPrioridade[task->prioridade + 20];
+    pesoProntas += task->pesoProntas;
+}
+
+void cfsDeixaProntas(task_t *task){
+    pesoProntas -= task->pesoProntas;
+
+    //a fatia é calculada quando a tarefa é despachada, com as prontas de então
+    task->quantum = cfsQuantum(task);
+}
+
+void cfsUsouProcessador(task_t *task, int tempo){
+    task->tempoVirtual += (long) tempo * CFS_PESO_NORMAL * CFS_PESO_NORMAL
+                          / grupoPesoEfetivo(task);
+}
+
+politica_t politicaCFS = {
+    .nome = "cfs",
+    .chave = cfsChave,
+    .quantum = cfsQuantum,
+    .antesEscolha = cfsAntesEscolha,
+    .pronta = cfsPronta,
+    .deixaProntas = cfsDeixaProntas,
+    .usouProcessador = cfsUsouProcessador,
+};
+
+
+//políticas indexadas pelo código usado em ppos_set_scheduler
+politica_t *politicas[] = {&politicaSRTF, &politicaMLFQ, &politicaStride, &politicaCFS};
+#define NUM_POLITICAS (sizeof(politicas) / sizeof(politicas[0]))
+
+
+/*
+Classe de tempo real (EDF). Uma tarefa periódica recebe, a cada período, um
+trabalho com orçamento de processador e prazo absoluto; enquanto há
+orçamento ela fica à frente das demais tarefas, pelo prazo (chaveTarefa). O
+orçamento é cobrado pelo tratador e, quando acaba, a tarefa passa a competir
+como as demais até o próximo período. O trabalho termina com
+task_wait_period; um trabalho que termina depois do prazo, ou que ainda não
+terminou quando o período seguinte começa, conta como uma perda de prazo.
+O controle de admissão recusa uma tarefa se a soma de orçamento/prazo das
+tarefas de tempo real passaria de 1, o limite em que o EDF garante os prazos.
+*/
+double utilizacaoTempoReal = 0.0;
+
+//primeira proximaLiberacao entre as tarefas de tempo real (só vale com
+//listaTempoReal não vazia); os instantes são comparados pela diferença,
+//como na roda de temporização, para atravessar a volta do contador
+unsigned int proximaLiberacaoTempoReal = UINT_MAX;
+
+
+//recalcula o próximo início de período entre as tarefas de tempo real
+void tempoRealProximaLiberacao(){
+    task_t *task;
+
+    if(listaTempoReal == NULL){
+        proximaLiberacaoTempoReal = UINT_MAX;
+        return;
+    }
+
+    proximaLiberacaoTempoReal = listaTempoReal->proximaLiberacao;
+    for(task = listaTempoReal->proxTempoReal; task != NULL; task = task->proxTempoReal)
+        if((int) (task->proximaLiberacao - proximaLiberacaoTempoReal) < 0)
+            proximaLiberacaoTempoReal = task->proximaLiberacao;
+}
+
+
+//inicia os períodos vencidos das tarefas de tempo real, contando as perdas
+//de prazo dos trabalhos que não terminaram
+void tempoRealLibera(){
+    unsigned char preempcaoAnterior = preemption;
+    task_t *task;
+
+    if(listaTempoReal == NULL || (int) (systemTime - proximaLiberacaoTempoReal) < 0)
+        return;
+
+    PPOS_PREEMPT_DISABLE
+
+    for(task = listaTempoReal; task != NULL; task = task->proxTempoReal){
+        if((int) (task->proximaLiberacao - systemTime) > 0)
+            continue;
+
+        while((int) (task->proximaLiberacao - systemTime) <= 0){
+            if(task->trabalhoPendente)
+                task->perdasPrazo++;
+
+            task->trabalhoPendente = 1;
+            task->trabalhos++;
+            task->orcamentoRestante = task->orcamento;
+            task->prazoAbsoluto = task->proximaLiberacao + task->prazoRelativo;
+            task->proximaLiberacao += task->periodo;
+        }
+        heapAtualiza(task);
+    }
+
+    tempoRealProximaLiberacao();
+
+    preemption = preempcaoAnterior;
+}
+
+
+//cobra da tarefa de tempo real corrente o tempo de processador usado; com o
+//orçamento esgotado, o quantum é zerado para que ela ceda o processador
+void tempoRealCobra(task_t *task, int decorrido){
+    if(!task->tempoReal || task->orcamentoRestante <= 0)
+        return;
+
+    task->orcamentoRestante -= decorrido;
+    if(task->orcamentoRestante <= 0){
+        task->orcamentoRestante = 0;
+        task->quantum = 0;
+    }
+}
+
+
+//retira a tarefa da classe de tempo real, devolvendo a sua utilização
+void tempoRealRetira(task_t *task){
+    task_t **ant;
+
+    if(!task->tempoReal)
+        return;
+
+    for(ant = &listaTempoReal; *ant != NULL; ant = &(*ant)->proxTempoReal){
+        if(*ant == task){
+            *ant = task->proxTempoReal;
+            break;
+        }
+    }
+
+    task->tempoReal = 0;
+    task->proxTempoReal = NULL;
+    utilizacaoTempoReal -= (double) task->orcamento / task->prazoRelativo;
+    tempoRealProximaLiberacao();
+}
+
+
+/*
+Torna a tarefa task (ou a tarefa corrente) periódica de tempo real, com o
+primeiro período começando agora. Devolve -1 para parâmetros inválidos ou
+se a tarefa não passar no controle de admissão.
+*/
+int task_set_deadline(task_t *task, int period, int budget, int deadline){
+    unsigned char preempcaoAnterior = preemption;
+    double utilizacao;
+
+    if(task == NULL)
+        task = taskExec;
+
+    if(budget <= 0 || deadline < budget || period < deadline)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+
+    //a tarefa pode estar mudando de parâmetros
+    utilizacao = utilizacaoTempoReal + (double) budget / deadline;
+    if(task->tempoReal)
+        utilizacao -= (double) task->orcamento / task->prazoRelativo;
+
+    if(utilizacao > 1.0){
+        preemption = preempcaoAnterior;
+        return -1;
+    }
+
+    tempoRealRetira(task);
+
+    task->tempoReal = 1;
+    task->periodo = period;
+    task->orcamento = budget;
+    task->prazoRelativo = deadline;
+    task->orcamentoRestante = budget;
+    task->trabalhoPendente = 1;
+    task->trabalhos = 1;
+    task->perdasPrazo = 0;
+    task->prazoAbsoluto = systemTime + deadline;
+    task->proximaLiberacao = systemTime + period;
+    task->proxTempoReal = listaTempoReal;
+    listaTempoReal = task;
+    utilizacaoTempoReal = utilizacao;
+    tempoRealProximaLiberacao();
+
+    heapAtualiza(task);
+
+    preemption = preempcaoAnterior;
+    return 0;
+}
+
+
+/*
+Encerra o trabalho do período corrente da tarefa de tempo real corrente e a
+faz dormir até o início do próximo período, pelo mesmo caminho do task_sleep
+do núcleo (que só aceita segundos).
+*/
+void task_wait_period(){
+    if(!taskExec->tempoReal)
+        return;
+
+    before_task_sleep();
+
+    PPOS_PREEMPT_DISABLE
+
+    if(taskExec->trabalhoPendente && (int) (systemTime - taskExec->prazoAbsoluto) > 0)
+        taskExec->perdasPrazo++;
+    taskExec->trabalhoPendente = 0;
+
+    //o próximo período já começou: o trabalho dele é liberado sem dormir
+    if((int) (taskExec->proximaLiberacao - systemTime) <= 0){
+        tempoRealLibera();
+        PPOS_PREEMPT_ENABLE
+        return;
+    }
+
+    taskExec->awakeTime = taskExec->proximaLiberacao;
+    task_suspend(NULL, &sleepQueue);
+    after_task_sleep();
+
+    PPOS_PREEMPT_ENABLE
+    task_yield();
+}
+
+
+//recalcula o próximo início de período entre os grupos com limite de banda
+void grupoProximaRecarga(){
+    taskgroup_t *grupo;
+
+    proximaRecargaGrupos = UINT_MAX;
+    for(grupo = gruposComLimite; grupo != NULL; grupo = grupo->proxComLimite)
+        if(grupo->proximaRecarga < proximaRecargaGrupos)
+            proximaRecargaGrupos = grupo->proximaRecarga;
+}
+
+
+//inicia os períodos vencidos dos grupos com limite de banda, devolvendo ao
+//heap as tarefas retidas pelos grupos que estavam estrangulados
+void grupoRecarrega(){
+    unsigned char preempcaoAnterior = preemption;
+    taskgroup_t *grupo;
+    task_t *task;
+
+    if(systemTime < proximaRecargaGrupos)
+        return;
+
+    PPOS_PREEMPT_DISABLE
+
+    for(grupo = gruposComLimite; grupo != NULL; grupo = grupo->proxComLimite){
+        if(grupo->proximaRecarga > systemTime)
+            continue;
+
+        while(grupo->proximaRecarga <= systemTime)
+            grupo->proximaRecarga += grupo->periodo;
+        grupo->consumido = 0;
+
+        if(grupo->estrangulado){
+            grupo->estrangulado = 0;
+            gruposEstrangulados--;
+
+            //uma tarefa pode continuar retida por outro grupo acima dela
+            while((task = grupo->estacionadas) != NULL){
+                grupoDesestaciona(task);
+                heapInsere(task);
+            }
+        }
+    }
+
+    grupoProximaRecarga();
+
+    preemption = preempcaoAnterior;
+}
+
+
+//retira o grupo da lista de grupos com limite de banda
+void grupoRetiraLimite(taskgroup_t *group){
+    taskgroup_t **ant;
+
+    for(ant = &gruposComLimite; *ant != NULL; ant = &(*ant)->proxComLimite){
+        if(*ant == group){
+            *ant = group->proxComLimite;
+            break;
+        }
+    }
+    group->proxComLimite = NULL;
+    grupoProximaRecarga();
+}
+
+
+//cria um grupo de tarefas dentro do grupo parent (ou no nível mais alto)
+int taskgroup_create(taskgroup_t *group, taskgroup_t *parent, int shares){
+    if(group == NULL || (parent != NULL && !parent->active))
+        return -1;
+
+    memset(group, 0, sizeof(taskgroup_t));
+    group->pai = parent;
+    group->cotas = (shares > 0) ? shares : 1024;
+    group->active = 1;
+
+    if(parent != NULL)
+        parent->filhos++;
+
+    return 0;
+}
+
+
+/*
+Limita o grupo a quota ms de processador a cada period ms, com o primeiro
+período começando agora; quota 0 retira o limite (e libera as tarefas
+retidas, se o grupo estava estrangulado).
+*/
+int taskgroup_set_bandwidth(taskgroup_t *group, int period, int quota){
+    unsigned char preempcaoAnterior = preemption;
+
+    if(group == NULL || !group->active || quota < 0 || (quota > 0 && (period <= 0 || quota > period)))
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+
+    //o grupo estrangulado é recarregado antes de mudar de parâmetros
+    if(group->estrangulado){
+        group->proximaRecarga = systemTime;
+        proximaRecargaGrupos = systemTime;
+        grupoRecarrega();
+    }
+    if(group->quota > 0)
+        grupoRetiraLimite(group);
+
+    group->periodo = period;
+    group->quota = quota;
+    group->consumido = 0;
+
+    if(quota > 0){
+        group->proximaRecarga = systemTime + period;
+        group->proxComLimite = gruposComLimite;
+        gruposComLimite = group;
+        grupoProximaRecarga();
+    }
+
+    preemption = preempcaoAnterior;
+    return 0;
+}
+
+
+//destroi um grupo sem tarefas nem grupos filhos
+int taskgroup_destroy(taskgroup_t *group){
+    unsigned char preempcaoAnterior = preemption;
+
+    if(group == NULL || !group->active || group->membros > 0 || group->filhos > 0)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+
+    if(group->quota > 0)
+        grupoRetiraLimite(group);
+    if(group->pai != NULL)
+        group->pai->filhos--;
+    group->active = 0;
+
+    preemption = preempcaoAnterior;
+    return 0;
+}
+
+
+/*
+Coloca a tarefa task (ou a tarefa corrente) no grupo group, ou a retira do
+seu grupo se group for NULL. Uma tarefa pronta sai do heap (ou da lista de
+retidas) e volta a ele já no novo grupo, que pode retê-la se estiver
+estrangulado.
+*/
+int task_join_group(task_t *task, taskgroup_t *group){
+    unsigned char preempcaoAnterior = preemption;
+    int pronta, ativa;
+
+    if(task == NULL)
+        task = taskExec;
+
+    if(task == taskDisp || task->state == 'x' || (group != NULL && !group->active))
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+
+    pronta = task->posicaoHeap != 0 || task->estacionadaEm != NULL;
+    ativa = pronta || task == taskExec;
+
+    grupoDesestaciona(task);
+    heapRemove(task);
+    grupoDesativa(task);
+
+    if(task->grupo != NULL)
+        task->grupo->membros--;
+    task->grupo = group;
+    if(group != NULL)
+        group->membros++;
+
+    if(pronta)
+        heapInsere(task);
+    else if(ativa)
+        grupoAtiva(task);
+
+    preemption = preempcaoAnterior;
+    return 0;
+}
+
+
+//configura o envelhecimento do SRTF; só tem efeito antes do ppos_init
+int ppos_set_aging(int taxa, int espera){
+    if(taskExec != NULL)
+        return -1;
+
+    if(taxa < 0 || espera < 0)
+        return -1;
+
+    taxaEnvelhecimento = taxa;
+    esperaMaxima = espera;
+    return 0;
+}
+
+
+//configura os limites da fatia adaptativa; só tem efeito antes do ppos_init
+int ppos_set_quantum(int minimo, int maximo){
+    if(taskExec != NULL)
+        return -1;
+
+    if(minimo < 1 || maximo < minimo)
+        return -1;
+
+    quantumMinimo = minimo;
+    quantumMaximo = maximo;
+    return 0;
+}
+
+
+//escolhe a política de escalonamento; só tem efeito antes do ppos_init
+int ppos_set_scheduler(int codigo){
+    if(taskExec != NULL)
+        return -1;
+
+    if(codigo < 0 || codigo >= NUM_POLITICAS)
+        return -1;
+
+    politica = politicas[codigo];
+    return 0;
+}
+
+
+/*
+Roda de temporização hierárquica para as tarefas adormecidas (task_sleep).
+O núcleo coloca a tarefa na sleepQueue e o dispatcher percorre essa fila
+inteira a cada volta; aqui a tarefa é retirada da sleepQueue logo em seguida
+(after_task_sleep) e guardada na roda, que tem três níveis de 256 posições:
+1 ms, 256 ms e 65536 ms por posição. Inserção e cancelamento custam O(1) e
+o avanço só toca a posição que vence em cada ms (mais a migração de um
+nível superior a cada 256 ms). A roda é avançada pelo dispatcher, em lote
+(veja eventosProcessa). Quando o despertar vence, a tarefa volta para a
+sleepQueue já vencida e é acordada normalmente.
+Os cálculos usam aritmética sem sinal, de modo que a volta do contador
+systemTime (unsigned int) é tratada naturalmente.
+*/
+#define RODA_NIVEIS   3
+#define RODA_POSICOES 256
+#define RODA_BITS     8
+
+task_t *rodaSono[RODA_NIVEIS][RODA_POSICOES];
+
+//último instante (em ms) já processado pela roda
+unsigned int tempoRoda = 0;
+
+//número de tarefas guardadas na roda
+int tarefasNaRoda = 0;
+
+//limite inferior do instante (em ms) do próximo evento da roda, para o
+//tratador saber em O(1) se há despertar vencido (veja eventosVencidos)
+unsigned int proximoDespertar = 0;
+
+//diferente de zero enquanto o núcleo ou um hook mexe na sleepQueue ou na
+//roda; nesse caso o tratador não consulta as filas (veja ociosoEspera)
+volatile int filasEmUso = 0;
+
+
+//insere a tarefa no início da lista indicada da roda
+void rodaEncadeia(task_t *task, task_t **lista){
+    task->antRoda = NULL;
+    task->proxRoda = *lista;
+    if(*lista != NULL)
+        (*lista)->antRoda = task;
+    *lista = task;
+    task->posicaoRoda = lista;
+    tarefasNaRoda++;
+}
+
+
+//retira a tarefa da lista da roda em que ela está (cancelamento em O(1))
+void rodaRetira(task_t *task){
+    if(task->posicaoRoda == NULL)
+        return;
+
+    if(task->antRoda != NULL)
+        task->antRoda->proxRoda = task->proxRoda;
+    else
+        *(task->posicaoRoda) = task->proxRoda;
+
+    if(task->proxRoda != NULL)
+        task->proxRoda->antRoda = task->antRoda;
+
+    task->proxRoda = task->antRoda = NULL;
+    task->posicaoRoda = NULL;
+    tarefasNaRoda--;
+}
+
+
+//devolve à sleepQueue uma tarefa cujo despertar venceu
+void rodaVence(task_t *task){
+    rodaRetira(task);
+
+    //prazo de uma espera (mutex_timedlock, cond_timedwait): a tarefa sai
+    //da fila do mutex ou da condição, a não ser que já tenha sido acordada
+    if((task_t **) task->queue != &sleepQueue){
+        if(task->state != 's')
+            return;
+        QUEUE_REMOVE((task_t **) task->queue, task);
+        task->queue = (task_t *) &sleepQueue;
+    }
+
+    //o dispatcher compara awakeTime <= systime() sem tratar a volta do
+    //contador; como o despertar já venceu, zerá-lo garante a comparação
+    task->awakeTime = 0;
+    QUEUE_APPEND(&sleepQueue, task);
+}
+
+
+//coloca a tarefa na posição da roda correspondente ao seu awakeTime
+void rodaInsere(task_t *task){
+    unsigned int distancia = task->awakeTime - tempoRoda;
+
+    //despertar já vencido (ou tão distante que parece negativo)
+    if(distancia == 0 || distancia > (unsigned int) INT_MAX){
+        rodaVence(task);
+        return;
+    }
+
+    if(tarefasNaRoda == 0 || (int) (task->awakeTime - proximoDespertar) < 0)
+        proximoDespertar = task->awakeTime;
+
+    if(distancia < (1u << RODA_BITS))
+        rodaEncadeia(task, &rodaSono[0][task->awakeTime & (RODA_POSICOES - 1)]);
+    else if(distancia < (1u << (2 * RODA_BITS)))
+        rodaEncadeia(task, &rodaSono[1][(task->awakeTime >> RODA_BITS) & (RODA_POSICOES - 1)]);
+    else if(distancia < (1u << (3 * RODA_BITS)))
+        rodaEncadeia(task, &rodaSono[2][(task->awakeTime >> (2 * RODA_BITS)) & (RODA_POSICOES - 1)]);
+    else
+        //além do alcance da roda: fica na última posição do nível mais alto
+        //e é reinserida quando essa posição for migrada
+        rodaEncadeia(task, &rodaSono[2][((tempoRoda >> (2 * RODA_BITS)) - 1) & (RODA_POSICOES - 1)]);
+}
+
+
+//redistribui as tarefas de uma posição de nível superior nos níveis inferiores
+void rodaMigra(int nivel, int posicao){
+    task_t *lista = rodaSono[nivel][posicao];
+    task_t *task;
+
+    rodaSono[nivel][posicao] = NULL;
+
+    while(lista != NULL){
+        task = lista;
+        lista = lista->proxRoda;
+
+        task->posicaoRoda = NULL;
+        task->proxRoda = task->antRoda = NULL;
+        tarefasNaRoda--;
+        rodaInsere(task);
+    }
+}
+
+
+//avança a roda até systemTime, devolvendo à sleepQueue os despertares vencidos
+void rodaAvanca(){
+    while(tempoRoda != systemTime){
+        tempoRoda++;
+
+        if((tempoRoda & (RODA_POSICOES - 1)) == 0){
+            if(((tempoRoda >> RODA_BITS) & (RODA_POSICOES - 1)) == 0)
+                rodaMigra(2, (tempoRoda >> (2 * RODA_BITS)) & (RODA_POSICOES - 1));
+            rodaMigra(1, (tempoRoda >> RODA_BITS) & (RODA_POSICOES - 1));
+        }
+
+        while(rodaSono[0][tempoRoda & (RODA_POSICOES - 1)] != NULL)
+            rodaVence(rodaSono[0][tempoRoda & (RODA_POSICOES - 1)]);
+    }
+}
+
+
+/*
+Intervalo, em ms, até o próximo evento da roda (INT_MAX se ela está vazia).
+Para os níveis superiores o evento é a migração da posição ocupada, que
+acontece no máximo no instante do despertar; ao migrar, a roda é reavaliada.
+*/
+int rodaProximoEvento(){
+    unsigned int base = tempoRoda;
+    int i, nivel;
+
+    if(tarefasNaRoda == 0)
+        return INT_MAX;
+
+    //há instantes ainda não processados pela roda
+    if(tempoRoda != systemTime)
+        return 0;
+
+    for(i = 1; i < RODA_POSICOES; i++)
+        if(rodaSono[0][(base + i) & (RODA_POSICOES - 1)] != NULL)
+            return i;
+
+    for(nivel = 1; nivel < RODA_NIVEIS; nivel++){
+        unsigned int bloco = base >> (nivel * RODA_BITS);
+
+        for(i = 1; i <= RODA_POSICOES; i++)
+            if(rodaSono[nivel][(bloco + i) & (RODA_POSICOES - 1)] != NULL)
+                return (int) (((bloco + i) << (nivel * RODA_BITS)) - base);
+    }
+
+    return INT_MAX;
+}
+
+
+/*
+Execução paralela (M:N). O núcleo (libppos_static.a) mantém todo o seu
+estado em variáveis globais (taskExec, readyQueue, as filas dos semáforos),
+então as tarefas do PPOS continuam executando numa única thread do sistema.
+O que vai para os outros núcleos do processador são trabalhos: com
+task_offload, a tarefa corrente entrega uma função a um conjunto de threads
+trabalhadoras (ppos_set_workers) e fica suspensa até a função terminar,
+enquanto as demais tarefas do PPOS continuam executando. Os trabalhos não
+podem chamar funções do PPOS.
+Cada trabalhadora tem um deque no estilo Chase-Lev: a thread do PPOS é a
+única que insere (na base), e todas as trabalhadoras retiram do topo com
+uma operação atômica (CAS); a trabalhadora sem trabalho no próprio deque
+rouba dos deques das outras, respeitando a afinidade da tarefa dona do
+trabalho (task_set_affinity).
+O trabalho de uma tarefa vai para a trabalhadora que executou o seu último
+trabalho, onde os dados dela ainda devem estar no cache, e tarefas que se
+comunicam pelo mesmo semáforo ou fila de mensagens vão para a mesma
+trabalhadora (escolhida pelo endereço do objeto). A trabalhadora preferida
+só é trocada pela menos carregada quando a diferença entre os seus deques
+passa de DESEQUILIBRIO_MAX trabalhos; cada troca de trabalhadora conta
+como uma migração da tarefa.
+Uma trabalhadora que não encontra trabalho que possa levar dorme numa
+variável de condição própria até o próximo aviso de trabalho novo; o
+aviso acorda a trabalhadora escolhida, ou uma ociosa se ela está ocupada.
+A tarefa que espera um trabalho fica fora de todas as filas, como as que
+aguardam o despertar na roda de temporização. O trabalho concluído entra
+numa pilha sem bloqueio (Treiber), que o dispatcher esvazia devolvendo as
+tarefas à sleepQueue já vencidas, para acordá-las. No modo TICKLESS a
+trabalhadora dispara o tratador com um SIGALRM. O mesmo caminho
+(tarefaAguarda e tarefaConclui) serve a quem precisa acordar uma tarefa a
+partir de outra thread ou de um tratador de sinal, como o gerente de disco.
+*/
+//a proibição das threads POSIX (ppos.h) vale para as aplicações; o núcleo
+//usa as threads do sistema só para executar os trabalhos
+#undef pthread_create
+#undef pthread_mutex_lock
+#undef pthread_mutex_unlock
+#undef pthread_cond_wait
+#undef pthread_cond_signal
+#undef pthread_cond_init
+
+#define TRABALHADORAS_MAX 64
+#define DEQUE_CAPACIDADE  1024 //potência de 2
+#define DESEQUILIBRIO_MAX 2
+
+typedef struct {
+    void (*func)(void *);
+    void *arg;
+    task_t *task;   //tarefa suspensa à espera do trabalho
+} trabalho_t;
+
+//topo e base ficam em linhas de cache separadas: as trabalhadoras disputam
+//o topo, e só a thread do PPOS escreve a base
+typedef struct {
+    _Atomic long topo __attribute__ ((aligned (64)));
+    _Atomic long base __attribute__ ((aligned (64)));
+    trabalho_t *_Atomic itens[DEQUE_CAPACIDADE];
+    //trabalhadoras permitidas à tarefa de cada trabalho: a ladra a consulta antes de levar
+    //o trabalho, sem tocar no trabalho (que está na pilha da tarefa)
+    _Atomic unsigned long afinidades[DEQUE_CAPACIDADE];
+} deque_t;
+
+deque_t deques[TRABALHADORAS_MAX];
+pthread_t trabalhadoras[TRABALHADORAS_MAX];
+int numTrabalhadoras = 0;
+
+//avisos de trabalho novo (alterado com a tranca em mãos); a trabalhadora
+//que não encontra trabalho que possa levar dorme na sua variável de condição
+//até ele mudar, com o seu bit em trabalhadorasOciosas (protegido pela tranca)
+_Atomic unsigned long avisosTrabalho = 0;
+unsigned long trabalhadorasOciosas = 0;
+pthread_mutex_t trancaTrabalhos = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t trabalhoDisponivel[TRABALHADORAS_MAX];
+
+//tarefas cujos trabalhos (ou esperas) terminaram, encadeadas por proxConcluida
+task_t *_Atomic trabalhosConcluidos = NULL;
+
+//thread do PPOS, que recebe o SIGALRM
+pthread_t threadPPOS;
+
+
+//trabalhadoras em que a tarefa pode executar (todas, se a afinidade não
+//inclui nenhuma das existentes)
+unsigned long trabalhadorasPermitidas(task_t *task){
+    unsigned long todas = (numTrabalhadoras == 64) ? ~0UL : (1UL << numTrabalhadoras) - 1;
+
+    return (task->afinidade & todas) ? (task->afinidade & todas) : todas;
+}
+
+
+//insere um trabalho na base do deque (só a thread do PPOS); devolve -1 se
+//o deque está cheio
+int dequeInsere(deque_t *deque, trabalho_t *trabalho){
+    long base = atomic_load_explicit(&deque->base, memory_order_relaxed);
+    long topo = atomic_load_explicit(&deque->topo, memory_order_acquire);
+
+    if(base - topo >= DEQUE_CAPACIDADE)
+        return -1;
+
+    atomic_store_explicit(&deque->itens[base & (DEQUE_CAPACIDADE - 1)], trabalho, memory_order_relaxed);
+    atomic_store_explicit(&deque->afinidades[base & (DEQUE_CAPACIDADE - 1)],
+                          trabalhadorasPermitidas(trabalho->task), memory_order_relaxed);
+    atomic_store_explicit(&deque->base, base + 1, memory_order_release);
+    return 0;
+}
+
+
+//retira um trabalho do topo do deque para a trabalhadora ladra; devolve NULL
+//se o deque está vazio, se a tarefa do trabalho não pode executar na ladra
+//ou se outra trabalhadora levou o trabalho antes
+trabalho_t *dequeRouba(deque_t *deque, int ladra){
+    long topo = atomic_load_explicit(&deque->topo, memory_order_acquire);
+    long base;
+    trabalho_t *trabalho;
+
+    atomic_thread_fence(memory_order_seq_cst);
+    base = atomic_load_explicit(&deque->base, memory_order_acquire);
+    if(topo >= base)
+        return NULL;
+
+    if(!(atomic_load_explicit(&deque->afinidades[topo & (DEQUE_CAPACIDADE - 1)], memory_order_relaxed)
+         & (1UL << ladra)))
+        return NULL;
+
+    trabalho = atomic_load_explicit(&deque->itens[topo & (DEQUE_CAPACIDADE - 1)], memory_order_relaxed);
+    if(!atomic_compare_exchange_strong_explicit(&deque->topo, &topo, topo + 1,
+                                                memory_order_seq_cst, memory_order_relaxed))
+        return NULL;
+
+    return trabalho;
+}
+
+
+//tira a tarefa corrente de todas as filas até que ela seja entregue a
+//tarefaConclui; com a preempção desabilitada, a tarefa chama task_yield
+//em seguida (o tratador pode acordá-la antes mesmo disso)
+void tarefaAguarda(){
+    task_suspend(NULL, &sleepQueue);
+    filasEmUso++;
+    QUEUE_REMOVE(&sleepQueue, taskExec);
+    filasEmUso--;
+}
+
+
+//entrega ao tratador uma tarefa que está em tarefaAguarda; pode ser chamada
+//por uma thread trabalhadora ou por um tratador de sinal
+void tarefaConclui(task_t *task){
+    task->proxConcluida = atomic_load(&trabalhosConcluidos);
+    while(!atomic_compare_exchange_weak(&trabalhosConcluidos, &task->proxConcluida, task))
+        ;
+#ifdef TICKLESS
+    pthread_kill(threadPPOS, SIGALRM);
+#endif
+}
+
+
+//laço das threads trabalhadoras
+void *trabalhadoraCorpo(void *arg){
+    int eu = (long) arg;
+    int i;
+    unsigned long visto;
+    trabalho_t *trabalho;
+    task_t *task;
+
+    for(;;){
+        //o aviso é lido antes da busca: um trabalho inserido depois dela o muda
+        visto = atomic_load(&avisosTrabalho);
+
+        //primeiro o próprio deque, depois os das outras trabalhadoras
+        trabalho = NULL;
+        for(i = 0; trabalho == NULL && i < numTrabalhadoras; i++)
+            trabalho = dequeRouba(&deques[(eu + i) % numTrabalhadoras], eu);
+
+        //nada que esta trabalhadora possa levar (mesmo que haja trabalhos
+        //de tarefas presas a outras): dorme até o próximo aviso
+        if(trabalho == NULL){
+            pthread_mutex_lock(&trancaTrabalhos);
+            while(atomic_load(&avisosTrabalho) == visto){
+                trabalhadorasOciosas |= 1UL << eu;
+                pthread_cond_wait(&trabalhoDisponivel[eu], &trancaTrabalhos);
+            }
+            trabalhadorasOciosas &= ~(1UL << eu);
+            pthread_mutex_unlock(&trancaTrabalhos);
+            continue;
+        }
+
+        //a tarefa está suspensa: só esta trabalhadora mexe nos seus campos
+        task = trabalho->task;
+        if(task->ultimaTrabalhadora >= 0 && task->ultimaTrabalhadora != eu)
+            task->migracoes++;
+        task->ultimaTrabalhadora = eu;
+
+        trabalho->func(trabalho->arg);
+
+        //o trabalho (na pilha da tarefa) não é mais acessado depois daqui
+        tarefaConclui(task);
+    }
+    return NULL;
+}
+
+
+//devolve à sleepQueue, já vencidas e na ordem em que foram entregues, as
+//tarefas cujos trabalhos (ou esperas) terminaram; a pilha é esvaziada de uma
+//vez e invertida, o que faz dela uma fila com vários produtores e um só
+//consumidor (fora de uma manipulação das filas)
+void trabalhosAcorda(){
+    task_t *task, *proxima, *lote = NULL;
+
+    if(atomic_load_explicit(&trabalhosConcluidos, memory_order_relaxed) == NULL)
+        return;
+
+    for(task = atomic_exchange(&trabalhosConcluidos, NULL); task != NULL; task = proxima){
+        proxima = task->proxConcluida;
+        task->proxConcluida = lote;
+        lote = task;
+    }
+
+    for(task = lote; task != NULL; task = proxima){
+        proxima = task->proxConcluida;
+        task->awakeTime = 0;
+        QUEUE_APPEND(&sleepQueue, task);
+    }
+}
+
+
+//cria n threads trabalhadoras (só uma vez); elas não recebem o SIGALRM do
+//temporizador, que precisa chegar à thread do PPOS
+int ppos_set_workers(int n){
+    sigset_t alarme, anterior;
+    long i;
+
+    if(numTrabalhadoras > 0 || n <= 0 || n > TRABALHADORAS_MAX)
+        return -1;
+
+    sigemptyset(&alarme);
+    sigaddset(&alarme, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &alarme, &anterior);
+
+    threadPPOS = pthread_self();
+    numTrabalhadoras = n;
+    for(i = 0; i < n; i++)
+        pthread_cond_init(&trabalhoDisponivel[i], NULL);
+    for(i = 0; i < n; i++){
+        if(pthread_create(&trabalhadoras[i], NULL, trabalhadoraCorpo, (void *) i) != 0){
+            perror("Erro ao criar as threads trabalhadoras: ");
+            exit(1);
+        }
+    }
+
+    pthread_sigmask(SIG_SETMASK, &anterior, NULL);
+    return 0;
+}
+
+
+//número de trabalhos no deque (aproximado, lido pela thread do PPOS)
+long dequeCarga(deque_t *deque){
+    return atomic_load_explicit(&deque->base, memory_order_relaxed)
+           - atomic_load_explicit(&deque->topo, memory_order_relaxed);
+}
+
+
+/*
+Escolhe a trabalhadora que recebe o próximo trabalho da tarefa: a do objeto
+pelo qual ela se comunica, senão a do seu último trabalho, senão a menos
+carregada; a preferida é trocada pela menos carregada se o desequilíbrio
+passar de DESEQUILIBRIO_MAX. Devolve -1 se os deques permitidos estão cheios.
+*/
+int trabalhadoraEscolhe(task_t *task){
+    unsigned long permitidas = trabalhadorasPermitidas(task);
+    int i, preferida = -1, menosCarregada = -1;
+
+    for(i = 0; i < numTrabalhadoras; i++){
+        if(!(permitidas & (1UL << i)) || dequeCarga(&deques[i]) >= DEQUE_CAPACIDADE)
+            continue;
+        if(menosCarregada < 0 || dequeCarga(&deques[i]) < dequeCarga(&deques[menosCarregada]))
+            menosCarregada = i;
+    }
+    if(menosCarregada < 0)
+        return -1;
+
+    if(task->objetoComunicacao != NULL)
+        preferida = ((unsigned long) task->objetoComunicacao / sizeof(void *)) % numTrabalhadoras;
+    if((preferida < 0 || !(permitidas & (1UL << preferida))) && task->ultimaTrabalhadora >= 0)
+        preferida = task->ultimaTrabalhadora;
+
+    if(preferida < 0 || !(permitidas & (1UL << preferida))
+       || dequeCarga(&deques[preferida]) >= DEQUE_CAPACIDADE
+       || dequeCarga(&deques[preferida]) - dequeCarga(&deques[menosCarregada]) > DESEQUILIBRIO_MAX)
+        return menosCarregada;
+
+    return preferida;
+}
+
+
+//registra o objeto (semáforo ou fila de mensagens) pelo qual a tarefa
+//corrente se comunica, para aproximar o seu trabalho do das tarefas parceiras
+void comunicacaoRegistra(void *objeto){
+    if(taskExec != NULL)
+        taskExec->objetoComunicacao = objeto;
+}
+
+
+//define as trabalhadoras em que o trabalho da tarefa pode executar (bit i
+//para a trabalhadora i; 0 permite todas)
+int task_set_affinity(task_t *task, unsigned long mascara){
+    if(task == NULL)
+        task = taskExec;
+
+    task->afinidade = (mascara == 0) ? ~0UL : mascara;
+    return 0;
+}
+
+
+//devolve a trabalhadora que executou o último trabalho da tarefa (-1 se nenhuma)
+int task_get_cpu(task_t *task){
+    if(task == NULL)
+        task = taskExec;
+
+    return task->ultimaTrabalhadora;
+}
+
+
+/*
+Executa func(arg) numa thread trabalhadora e suspende a tarefa corrente até
+a função terminar. Sem trabalhadoras (ou com os deques permitidos cheios) a
+função é executada pela própria tarefa.
+*/
+int task_offload(void (*func)(void *), void *arg){
+    trabalho_t trabalho;
+    int trabalhadora, acordada;
+    unsigned long livres;
+
+    if(func == NULL)
+        return -1;
+
+    trabalho.func = func;
+    trabalho.arg = arg;
+    trabalho.task = taskExec;
+
+    PPOS_PREEMPT_DISABLE
+
+    trabalhadora = (numTrabalhadoras > 0) ? trabalhadoraEscolhe(taskExec) : -1;
+
+    if(trabalhadora < 0 || dequeInsere(&deques[trabalhadora], &trabalho) < 0){
+        PPOS_PREEMPT_ENABLE
+        func(arg);
+        return 0;
+    }
+
+    //a tarefa só volta para a sleepQueue quando o trabalho terminar
+    tarefaAguarda();
+
+    //acorda a trabalhadora escolhida (e não uma qualquer, que levaria o
+    //trabalho para longe dos dados da tarefa); se ela está ocupada, acorda
+    //uma ociosa permitida, que o roubará. A thread do PPOS não pode ser
+    //preemptada com a tranca em mãos
+    pthread_mutex_lock(&trancaTrabalhos);
+    atomic_fetch_add(&avisosTrabalho, 1);
+    livres = trabalhadorasOciosas & trabalhadorasPermitidas(taskExec);
+    if(livres & (1UL << trabalhadora))
+        acordada = trabalhadora;
+    else
+        acordada = livres ? __builtin_ctzl(livres) : -1;
+    if(acordada >= 0){
+        trabalhadorasOciosas &= ~(1UL << acordada);
+        pthread_cond_signal(&trabalhoDisponivel[acordada]);
+    }
+    pthread_mutex_unlock(&trancaTrabalhos);
+
+    PPOS_PREEMPT_ENABLE
+    task_yield();
+    return 0;
+}
+
+
+/*
+Caminho rápido dos semáforos (desligado com -DSEMHOOKS, veja ppos.h). O
+sem_down e o sem_up do núcleo desabilitam a preempção, chamam os hooks e,
+no fim, cedem o processador a cada chamada. Aqui o valor do semáforo só
+conta as unidades livres, e o caminho rápido só o testa e atualiza com a
+preempção desabilitada; como a única concorrência é o tratador de sinais
+da própria thread, isso basta para a atualização ser atômica, sem as
+instruções com lock de um contador atômico (que custam mais que o caminho
+do núcleo inteiro). O sem_down que encontra uma unidade livre e o sem_up
+sem tarefas esperando não mexem em filas nem trocam de contexto. Só na disputa a tarefa entra no
+caminho lento, com a preempção desabilitada: espera na fila do semáforo
+(semaphore_t.queue) e, acordada por um sem_up, tenta de novo. O sem_up não
+entrega a unidade à tarefa acordada, que pode perdê-la para outra que
+chegue antes (como num futex); em troca, não há comboio de tarefas
+alternando a posse do semáforo. O sem_create e o sem_destroy continuam os
+do núcleo: o sem_destroy acorda as tarefas da fila, que desistem ao ver o
+semáforo desativado.
+*/
+#ifndef SEMHOOKS
+
+//caminho lento do sem_down: espera na fila do semáforo até haver unidade livre
+int semaforoEspera(semaphore_t *s){
+    for(;;){
+        PPOS_PREEMPT_DISABLE
+        if(!s->active){
+            PPOS_PREEMPT_ENABLE
+            return -1;
+        }
+
+        //sem preempção nenhuma outra tarefa mexe no valor
+        if(s->value > 0){
+            s->value--;
+            PPOS_PREEMPT_ENABLE
+            comunicacaoRegistra(s);
+            return 0;
+        }
+
+        task_suspend(NULL, &s->queue);
+        PPOS_PREEMPT_ENABLE
+        task_yield();
+    }
+}
+
+
+int sem_down_fast(semaphore_t *s){
+    if(s == NULL || !s->active)
+        return -1;
+
+    //só o tratador de sinais interrompe a tarefa, e ele não troca de tarefa
+    //sem preempção: o teste e o decremento do valor ficam indivisíveis sem
+    //instruções com lock (as cercas só impedem o compilador de tirá-los de
+    //dentro da região)
+    PPOS_PREEMPT_DISABLE
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    if(s->value > 0){
+        s->value--;
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        PPOS_PREEMPT_ENABLE
+        comunicacaoRegistra(s);
+        return 0;
+    }
+    PPOS_PREEMPT_ENABLE
+
+    return semaforoEspera(s);
+}
+
+
+int sem_up_fast(semaphore_t *s){
+    if(s == NULL || !s->active)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    s->value++;
+
+    //uma tarefa na fila já viu o valor anterior: ela é acordada para tentar
+    //de novo (a fila é testada ainda sem preempção, então nenhuma tarefa
+    //suspende entre o incremento e o teste)
+    if(s->queue != NULL)
+        task_resume(s->queue);
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    PPOS_PREEMPT_ENABLE
+
+    comunicacaoRegistra(s);
+    return 0;
+}
+
+#endif
+
+
+/*
+Mutex adaptativo. O mutex do núcleo coloca na fila, na hora, quem o
+encontra ocupado. Aqui, enquanto o dono está pronto (e não há fila), a
+tarefa cede o processador até MUTEX_CEDENCIAS vezes e tenta de novo: com um
+único processador para as tarefas, girar à espera só gastaria a fatia, e
+ceder é o que deixa o dono chegar ao mutex_unlock. Posses curtas se
+resolvem assim, sem fila; com o dono suspenso (esperando o disco, um
+trabalho ou outro recurso), ou depois das cedências, a tarefa espera na fila
+do mutex. O mutex_unlock entrega o mutex diretamente à primeira da fila, a
+que espera há mais tempo: o mutex não fica livre no meio da entrega, então
+as tarefas acordadas não voltam a disputá-lo com quem chega. O
+mutex_timedlock espera também na roda de temporização: se o prazo vence
+antes da entrega, a tarefa sai da fila do mutex (rodaVence). O
+mutex_create e o mutex_destroy continuam os do núcleo; o mutex_destroy
+acorda as tarefas da fila, que desistem ao ver o mutex desativado.
+
+Herança de prioridade: uma tarefa urgente que espera na fila de um mutex
+não pode ficar atrás das tarefas que o escalonador prefere ao dono (no
+SRTF, as de tempo restante menor que o dele), senão ela espera por todas
+elas (inversão de prioridade). O dono herda a menor chave entre as tarefas
+que esperam os mutexes que ele detém (chaveHerdada, que chaveTarefa usa no
+lugar da sua, se for menor), e a herança segue a cadeia quando o dono, por
+sua vez, espera o mutex de outra tarefa. Ao liberar o mutex, o dono volta à
+chave herdada dos mutexes que ainda detém (ou à sua), e a tarefa que o
+recebe herda das que continuam na fila.
+*/
+#define MUTEX_CEDENCIAS 3
+
+//herança de prioridade ligada (ppos_set_inheritance)
+int herancaPrioridade = 1;
+
+#ifdef TICKLESS
+extern volatile int atualizandoRelogio;
+void contabilizaTempo();
+#endif
+
+
+//conta uma aquisição do mutex pela tarefa corrente, que esperou desde inicio
+void mutexContaAquisicao(mutex_t *m, unsigned int inicio){
+    int espera = systemTime - inicio;
+
+    m->aquisicoes++;
+    m->tempoEspera += espera;
+    if(espera > m->esperaMaxima)
+        m->esperaMaxima = espera;
+}
+
+
+//coloca o mutex na lista de mutexes detidos pela tarefa
+void mutexPassa(mutex_t *m, task_t *task){
+    m->dono = task;
+    m->proxDetido = task->mutexesDetidos;
+    task->mutexesDetidos = m;
+}
+
+
+//retira o mutex da lista de mutexes detidos pelo seu dono
+void mutexDesliga(mutex_t *m){
+    mutex_t **elo;
+
+    if(m->dono == NULL)
+        return;
+
+    for(elo = &m->dono->mutexesDetidos; *elo != NULL; elo = &(*elo)->proxDetido)
+        if(*elo == m){
+            *elo = m->proxDetido;
+            break;
+        }
+    m->proxDetido = NULL;
+    m->dono = NULL;
+}
+
+
+/*
+Recalcula a chave herdada pela tarefa, a menor entre as das tarefas que
+esperam os mutexes que ela detém, e propaga a mudança pela cadeia: se a
+tarefa espera outro mutex, o dono dele é recalculado em seguida. A cadeia é
+limitada pelo número de tarefas, para que um impasse (cadeia circular) não
+prenda o laço.
+*/
+void herancaRecalcula(task_t *task){
+    mutex_t *m;
+    task_t *espera;
+    long chave, chaveEspera;
+    long passos = countTasks + 1;
+
+    for(; task != NULL && passos > 0; passos--){
+        chave = LONG_MAX;
+
+        if(herancaPrioridade)
+            for(m = task->mutexesDetidos; m != NULL; m = m->proxDetido){
+                if((espera = m->queue) == NULL)
+                    continue;
+                do{
+                    chaveEspera = chaveTarefa(espera);
+                    if(chaveAntes(chaveEspera, chave))
+                        chave = chaveEspera;
+                    espera = espera->next;
+                } while(espera != m->queue);
+            }
+
+        if(chave == task->chaveHerdada)
+            return;
+
+        task->chaveHerdada = chave;
+        heapAtualiza(task);
+        task = (task->mutexEsperado != NULL) ? task->mutexEsperado->dono : NULL;
+    }
+}
+
+
+//liga ou desliga a herança de prioridade dos mutexes
+int ppos_set_inheritance(int ativa){
+    if(ativa != 0 && ativa != 1)
+        return -1;
+
+    herancaPrioridade = ativa;
+    return 0;
+}
+
+
+//o mutex (livre) passa para a tarefa corrente
+void mutexAssume(mutex_t *m, unsigned int inicio){
+    m->value = 0;
+    m->inicioPosse = systemTime;
+    mutexPassa(m, taskExec);
+    mutexContaAquisicao(m, inicio);
+}
+
+
+/*
+Obtém o mutex esperando no máximo prazo ms (prazo negativo: sem limite;
+zero: não espera). Devolve 0 com o mutex obtido e -1 se ele foi destruído
+ou se o prazo esgotou.
+*/
+int mutexAdquire(mutex_t *m, int prazo){
+    unsigned int inicio;
+    int cedencias = 0;
+
+    if(m == NULL || !m->active)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+#ifdef TICKLESS
+    //o prazo é contado a partir do relógio atual
+    if(prazo > 0){
+        atualizandoRelogio = 1;
+        contabilizaTempo();
+        atualizandoRelogio = 0;
+    }
+#endif
+    inicio = systemTime;
+
+    if(m->value){
+        mutexAssume(m, inicio);
+        PPOS_PREEMPT_ENABLE
+        return 0;
+    }
+    if(prazo == 0){
+        PPOS_PREEMPT_ENABLE
+        return -1;
+    }
+    m->disputas++;
+
+    //dono pronto: cede o processador para ele terminar a posse; se o
+    //escalonador preferiria a tarefa ao dono, ela voltaria logo ao
+    //processador, e é melhor esperar na fila, onde o dono a herda
+    while(cedencias < MUTEX_CEDENCIAS && m->queue == NULL && m->dono != NULL && m->dono->state != 's'
+          && !chaveAntes(chaveTarefa(taskExec), chaveTarefa(m->dono))){
+        cedencias++;
+        PPOS_PREEMPT_ENABLE
+        task_yield();
+        PPOS_PREEMPT_DISABLE
+
+        if(!m->active){
+            PPOS_PREEMPT_ENABLE
+            return -1;
+        }
+        if(m->value){
+            mutexAssume(m, inicio);
+            PPOS_PREEMPT_ENABLE
+            return 0;
+        }
+    }
+
+    for(;;){
+        task_suspend(NULL, &m->queue);
+        taskExec->mutexEsperado = m;
+        herancaRecalcula(m->dono);
+        if(prazo > 0){
+            taskExec->awakeTime = inicio + prazo;
+            filasEmUso++;
+            rodaInsere(taskExec);
+            filasEmUso--;
+        }
+        PPOS_PREEMPT_ENABLE
+        task_yield();
+        PPOS_PREEMPT_DISABLE
+
+        //acordada antes do prazo: o despertar pendente é cancelado
+        if(taskExec->posicaoRoda != NULL){
+            filasEmUso++;
+            rodaRetira(taskExec);
+            filasEmUso--;
+        }
+        taskExec->mutexEsperado = NULL;
+
+        //o mutex_unlock já entregou o mutex a esta tarefa
+        if(m->dono == taskExec){
+            mutexContaAquisicao(m, inicio);
+            PPOS_PREEMPT_ENABLE
+            return 0;
+        }
+
+        if(!m->active){
+            PPOS_PREEMPT_ENABLE
+            return -1;
+        }
+
+        //prazo esgotado: só obtém o mutex se ele estiver livre agora; se
+        //não, o dono deixa de herdar a chave desta tarefa
+        if(prazo > 0){
+            if(m->value)
+                mutexAssume(m, inicio);
+            else{
+                m->esgotados++;
+                herancaRecalcula(m->dono);
+            }
+            PPOS_PREEMPT_ENABLE
+            return (m->dono == taskExec) ? 0 : -1;
+        }
+    }
+}
+
+
+int mutex_lock_adapt(mutex_t *m){
+    return mutexAdquire(m, -1);
+}
+
+
+int mutex_trylock(mutex_t *m){
+    return mutexAdquire(m, 0);
+}
+
+
+int mutex_timedlock(mutex_t *m, int ms){
+    return mutexAdquire(m, (ms > 0) ? ms : 0);
+}
+
+
+/*
+Libera o mutex da tarefa corrente e devolve a tarefa que o recebeu (NULL se
+ele ficou livre); chamada com a preempção desabilitada.
+*/
+task_t *mutexLibera(mutex_t *m){
+    task_t *proxima;
+
+    m->tempoPosse += systemTime - m->inicioPosse;
+    mutexDesliga(m);
+
+    //entrega direta: o mutex continua ocupado, agora pela primeira da fila,
+    //que herda das tarefas que continuam nela
+    proxima = m->queue;
+    if(proxima != NULL){
+        m->inicioPosse = systemTime;
+        mutexPassa(m, proxima);
+        proxima->mutexEsperado = NULL;
+        task_resume(proxima);
+        herancaRecalcula(proxima);
+    }
+    else
+        m->value = 1;
+
+    //a tarefa corrente perde a chave herdada desse mutex
+    herancaRecalcula(taskExec);
+    return proxima;
+}
+
+
+int mutex_unlock_adapt(mutex_t *m){
+    task_t *proxima;
+
+    if(m == NULL || !m->active || m->dono != taskExec)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+    proxima = mutexLibera(m);
+    PPOS_PREEMPT_ENABLE
+
+    //sem a chave herdada, a tarefa corrente pode ter deixado de ser a mais
+    //urgente (a que recebeu o mutex, por exemplo)
+    if(proxima != NULL && prontaMaisUrgente())
+        task_yield();
+    return 0;
+}
+
+
+/*
+Rwlock (leitores e escritores). Os leitores compartilham o rwlock e o
+escritor o detém sozinho. Com preferência aos escritores: um leitor que
+chega com escritor esperando também espera, para que um fluxo contínuo de
+leitores não deixe o escritor para sempre na fila. Como no mutex, a posse é
+entregue na liberação, sem que as tarefas acordadas voltem a disputá-la: o
+último leitor a sair entrega o rwlock ao primeiro escritor da fila, e o
+escritor que sai entrega aos leitores que esperavam, todos de uma vez (sem
+leitores esperando, ao próximo escritor). Os leitores acordados já contam
+em leitores e entram juntos no heap de prontas, então o dispatcher os
+despacha em seguida, sem rodadas de disputa entre eles; alternar lotes de
+leitores e escritores também impede que os escritores deixem os leitores
+para sempre na fila.
+Como o mutex, o rwlock só é liberado por quem o detém: cada leitura ocupa
+uma das LEITURAS_MAX entradas do TCB do leitor, encadeada na lista de
+leituras do rwlock (que o rwlock_destroy esvazia).
+*/
+
+int rwlock_create(rwlock_t *rw){
+    if(rw == NULL)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+    rw->leitoresEsperando = rw->escritoresEsperando = NULL;
+    rw->escritor = NULL;
+    rw->leitores = 0;
+    rw->leituras = NULL;
+    rw->esperasLeitura = rw->esperasEscrita = 0;
+    rw->active = 1;
+    PPOS_PREEMPT_ENABLE
+    return 0;
+}
+
+
+//devolve uma entrada de leitura livre da tarefa (NULL se ela já detém
+//LEITURAS_MAX leituras)
+leitura_t *leituraLivre(task_t *task){
+    int i;
+
+    for(i = 0; i < LEITURAS_MAX; i++)
+        if(task->leituras[i].rw == NULL)
+            return &task->leituras[i];
+    return NULL;
+}
+
+
+//registra a leitura do rwlock na entrada livre
+void leituraRegistra(rwlock_t *rw, leitura_t *leitura){
+    leitura->rw = rw;
+    leitura->ant = NULL;
+    leitura->prox = rw->leituras;
+    if(rw->leituras != NULL)
+        rw->leituras->ant = leitura;
+    rw->leituras = leitura;
+}
+
+
+//tira a leitura da lista do rwlock e libera a entrada
+void leituraRetira(leitura_t *leitura){
+    if(leitura->ant != NULL)
+        leitura->ant->prox = leitura->prox;
+    else
+        leitura->rw->leituras = leitura->prox;
+    if(leitura->prox != NULL)
+        leitura->prox->ant = leitura->ant;
+    leitura->rw = NULL;
+}
+
+
+//espera na fila indicada do rwlock até a entrega (devolve -1 se ele foi
+//destruído); chamada com a preempção desabilitada
+int rwlockEspera(rwlock_t *rw, task_t **fila){
+    task_suspend(NULL, fila);
+    PPOS_PREEMPT_ENABLE
+    task_yield();
+
+    return rw->active ? 0 : -1;
+}
+
+
+int rwlock_rdlock(rwlock_t *rw){
+    leitura_t *leitura;
+
+    if(rw == NULL || !rw->active)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+    leitura = leituraLivre(taskExec);
+    if(leitura == NULL){
+        PPOS_PREEMPT_ENABLE
+        return -1;
+    }
+
+    if(rw->escritor == NULL && rw->escritoresEsperando == NULL){
+        rw->leitores++;
+        leituraRegistra(rw, leitura);
+        PPOS_PREEMPT_ENABLE
+        return 0;
+    }
+
+    //o escritor que sair já conta esta tarefa em leitores e registra a
+    //leitura na entrada livre
+    rw->esperasLeitura++;
+    return rwlockEspera(rw, &rw->leitoresEsperando);
+}
+
+
+int rwlock_wrlock(rwlock_t *rw){
+    if(rw == NULL || !rw->active)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+    if(rw->escritor == NULL && rw->leitores == 0){
+        rw->escritor = taskExec;
+        PPOS_PREEMPT_ENABLE
+        return 0;
+    }
+
+    //quem liberar o rwlock já o entrega a esta tarefa
+    rw->esperasEscrita++;
+    return rwlockEspera(rw, &rw->escritoresEsperando);
+}
+
+
+//acorda todos os leitores que esperam, que passam a deter o rwlock (cada um
+//tinha uma entrada livre ao começar a esperar)
+void rwlockAcordaLeitores(rwlock_t *rw){
+    while(rw->leitoresEsperando != NULL){
+        rw->leitores++;
+        leituraRegistra(rw, leituraLivre(rw->leitoresEsperando));
+        task_resume(rw->leitoresEsperando);
+    }
+}
+
+
+//entrega o rwlock ao primeiro escritor que espera
+void rwlockAcordaEscritor(rwlock_t *rw){
+    rw->escritor = rw->escritoresEsperando;
+    task_resume(rw->escritoresEsperando);
+}
+
+
+int rwlock_unlock(rwlock_t *rw){
+    int entregou = 1, i;
+
+    if(rw == NULL || !rw->active)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+    if(rw->escritor == taskExec){
+        rw->escritor = NULL;
+        if(rw->leitoresEsperando != NULL)
+            rwlockAcordaLeitores(rw);
+        else if(rw->escritoresEsperando != NULL)
+            rwlockAcordaEscritor(rw);
+        else
+            entregou = 0;
+    }
+    else{
+        //só uma tarefa que detém uma leitura deste rwlock pode liberá-la
+        for(i = 0; i < LEITURAS_MAX && taskExec->leituras[i].rw != rw; i++)
+            ;
+        if(i == LEITURAS_MAX){
+            PPOS_PREEMPT_ENABLE
+            return -1;
+        }
+        leituraRetira(&taskExec->leituras[i]);
+
+        rw->leitores--;
+        if(rw->leitores == 0 && rw->escritoresEsperando != NULL)
+            rwlockAcordaEscritor(rw);
+        else
+            entregou = 0;
+    }
+    PPOS_PREEMPT_ENABLE
+
+    //como no mutex_unlock, uma tarefa acordada mais urgente toma o processador
+    if(entregou && prontaMaisUrgente())
+        task_yield();
+    return 0;
+}
+
+
+int rwlock_destroy(rwlock_t *rw){
+    if(rw == NULL || !rw->active)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+    rw->active = 0;
+    while(rw->leituras != NULL)
+        leituraRetira(rw->leituras);
+    while(rw->leitoresEsperando != NULL)
+        task_resume(rw->leitoresEsperando);
+    while(rw->escritoresEsperando != NULL)
+        task_resume(rw->escritoresEsperando);
+    PPOS_PREEMPT_ENABLE
+    return 0;
+}
+
 
+/*
+Variáveis de condição com passagem direta para o mutex ("wait morphing").
+Acordar as tarefas que esperam a condição só para que disputem o mutex, que
+quem sinaliza em geral ainda detém, faria cada uma entrar no processador,
+encontrar o mutex ocupado e voltar a esperar, agora na fila dele (a manada
+do cond_broadcast). Aqui o cond_signal e o cond_broadcast passam as tarefas
+da fila da condição para a fila do mutex sem acordá-las: elas só voltam ao
+processador quando o mutex_unlock lhes entrega o mutex, uma de cada vez,
+pela entrega direta, e já emprestam a chave ao dono enquanto esperam
+(herança de prioridade). Se o mutex está livre, a primeira o recebe na hora
+e fica pronta. O cond_timedwait espera também na roda de temporização: se o
+prazo vence antes do sinal, a tarefa sai da fila da condição (rodaVence) e
+obtém o mutex como no mutex_lock; depois do sinal o prazo deixa de valer.
+*/
+
+int cond_create(cond_t *c){
+    if(c == NULL)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+    c->queue = NULL;
+    c->mutex = NULL;
+    c->sinais = c->esgotados = 0;
+    c->active = 1;
+    PPOS_PREEMPT_ENABLE
+    return 0;
+}
+
+
+/*
+Libera o mutex e espera a condição por no máximo prazo ms (prazo negativo:
+sem limite; zero: não espera). Devolve 0 se a condição foi sinalizada e -1
+se o prazo esgotou ou se ela foi destruída, sempre com o mutex obtido
+novamente (a não ser que o mutex tenha sido destruído).
+*/
+int condEspera(cond_t *c, mutex_t *m, int prazo){
+    if(c == NULL || !c->active || m == NULL || !m->active || m->dono != taskExec)
+        return -1;
+
+    //prazo nulo: esgota na hora, sem liberar o mutex
+    if(prazo == 0)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+    //as tarefas que esperam a condição ao mesmo tempo usam o mesmo mutex
+    if(c->queue != NULL && c->mutex != m){
+        PPOS_PREEMPT_ENABLE
+        return -1;
+    }
+#ifdef TICKLESS
+    //o prazo é contado a partir do relógio atual
+    if(prazo > 0){
+        atualizandoRelogio = 1;
+        contabilizaTempo();
+        atualizandoRelogio = 0;
+    }
+#endif
+    c->mutex = m;
+
+    mutexLibera(m);
+    task_suspend(NULL, &c->queue);
+    if(prazo > 0){
+        taskExec->awakeTime = systemTime + prazo;
+        filasEmUso++;
+        rodaInsere(taskExec);
+        filasEmUso--;
+    }
+    PPOS_PREEMPT_ENABLE
+    task_yield();
+    PPOS_PREEMPT_DISABLE
+
+    if(taskExec->posicaoRoda != NULL){
+        filasEmUso++;
+        rodaRetira(taskExec);
+        filasEmUso--;
+    }
+
+    //sinalizada: o mutex_unlock (ou o próprio sinal, com o mutex livre) já
+    //entregou o mutex a esta tarefa
+    if(m->dono == taskExec){
+        mutexContaAquisicao(m, taskExec->inicioEsperaMutex);
+        PPOS_PREEMPT_ENABLE
+        return c->active ? 0 : -1;
+    }
+
+    //prazo esgotado: volta a obter o mutex antes de retornar
+    if(m->active)
+        c->esgotados++;
+    PPOS_PREEMPT_ENABLE
+    mutexAdquire(m, -1);
+    return -1;
+}
+
+
+int cond_wait(cond_t *c, mutex_t *m){
+    return condEspera(c, m, -1);
+}
+
+
+int cond_timedwait(cond_t *c, mutex_t *m, int ms){
+    return condEspera(c, m, (ms > 0) ? ms : 0);
+}
+
+
+/*
+Passa ao mutex a tarefa que espera a condição há mais tempo: com o mutex
+livre (ou destruído), ela fica pronta, e a função devolve 1; senão, ela passa
+para a fila do mutex sem ser acordada. Quem chama recalcula a herança do dono
+do mutex; chamada com a preempção desabilitada.
+*/
+int condTransfere(cond_t *c){
+    task_t *task = c->queue;
+    mutex_t *m = c->mutex;
+
+    //o prazo do cond_timedwait só vale até o sinal
+    if(task->posicaoRoda != NULL){
+        filasEmUso++;
+        rodaRetira(task);
+        filasEmUso--;
+    }
+    task->inicioEsperaMutex = systemTime;
+    c->sinais++;
+
+    if(!m->active || m->value){
+        if(m->active){
+            m->value = 0;
+            m->inicioPosse = systemTime;
+            mutexPassa(m, task);
+        }
+        task_resume(task);
+        return 1;
+    }
+
+    m->disputas++;
+    QUEUE_REMOVE(&c->queue, task);
+    QUEUE_APPEND(&m->queue, task);
+    task->queue = (task_t *) &m->queue;
+    task->mutexEsperado = m;
+    return 0;
+}
+
+
+int cond_signal(cond_t *c){
+    int acordou = 0;
+
+    if(c == NULL || !c->active)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+    if(c->queue != NULL){
+        acordou = condTransfere(c);
+        herancaRecalcula(c->mutex->dono);
+    }
+    PPOS_PREEMPT_ENABLE
+
+    //como no mutex_unlock, uma tarefa acordada mais urgente toma o processador
+    if(acordou && prontaMaisUrgente())
+        task_yield();
+    return 0;
+}
+
+
+//todas as tarefas passam ao mutex de uma vez; no máximo uma fica pronta (a
+//que recebe o mutex, se ele está livre), e a herança é recalculada uma vez só
+int cond_broadcast(cond_t *c){
+    int acordou = 0;
+
+    if(c == NULL || !c->active)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+    if(c->queue != NULL){
+        while(c->queue != NULL)
+            acordou |= condTransfere(c);
+        herancaRecalcula(c->mutex->dono);
+    }
+    PPOS_PREEMPT_ENABLE
+
+    if(acordou && prontaMaisUrgente())
+        task_yield();
+    return 0;
+}
+
+
+int cond_destroy(cond_t *c){
+    if(c == NULL || !c->active)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+    c->active = 0;
+    if(c->queue != NULL){
+        while(c->queue != NULL)
+            condTransfere(c);
+        herancaRecalcula(c->mutex->dono);
+    }
+    PPOS_PREEMPT_ENABLE
+    return 0;
+}
 
 /*
 Esta função ajusta aprioridade com base no tempo de execução total estimado para cada tarefa. 
@@ -33,15 +3002,46 @@ void task_set_eet (task_t *task, int et){
     if(task == NULL){
         taskExec->tempoEstimado = et;
         taskExec->tempoRestante = et - taskExec->running_time;
+        taskExec->estimativaAutomatica = 0;
     }
     else {
         task->tempoEstimado = et;
+        task->estimativaAutomatica = 0;
         //o tempo restante é o tempo estimado menos o tempo que a tarefa já rodou na cpu
         task->tempoRestante = et - task->running_time;
+
+        //se a tarefa está pronta, sua posição no heap precisa ser corrigida
+        heapAtualiza(task);
     }
 }
 
 
+//define a prioridade estática de uma tarefa (ou da tarefa atual), de -20 a +20
+void task_setprio(task_t *task, int prio){
+    if(task == NULL)
+        task = taskExec;
+
+    if(prio < -20)
+        prio = -20;
+    if(prio > 20)
+        prio = 20;
+
+    task->prioridade = prio;
+
+    //se a tarefa está pronta, sua posição no heap precisa ser corrigida
+    heapAtualiza(task);
+}
+
+
+//devolve a prioridade estática de uma tarefa (ou da tarefa atual)
+int task_getprio(task_t *task){
+    if(task == NULL)
+        return taskExec->prioridade;
+    else
+        return task->prioridade;
+}
+
+
 /*
 Esta função devolve o valor do tempo
 restante para terminar a execução da tarefa task (ou da tarefa corrente, se task for nulo).*/
@@ -65,47 +3065,314 @@ int task_get_eet(task_t *task){
 }
 
 
+//task_create do núcleo (o nome entre parênteses não é trocado pela macro do
+//ppos.h), restaurando a preempção se a criação falhar
+int task_create_adapt(task_t *task, void (*start_func)(void *), void *arg){
+    int id = (task_create)(task, start_func, arg);
+
+    if(id < 0 && criandoTarefa){
+        criandoTarefa = 0;
+        preemption = preempcaoCriacao;
+    }
+    return id;
+}
+
+
 /*
-Analisa a fila de tarefas prontas, devolvendo um ponteiro para a
-próxima tarefa a receber o processador*/
-task_t * scheduler() {
-    
-    if (readyQueue == NULL) {
-        return NULL;
+Cria uma tarefa como o task_create, com uma pilha de pelo menos tamanhoPilha
+bytes (arredondado para a classe de tamanho de pilha mais próxima, ou sob
+medida acima da maior classe). A pilha é alocada antes da criação, que falha
+se ela não puder ser alocada. A preempção fica desabilitada durante a
+criação, para que a pilha pedida seja usada por esta tarefa e não por outra.
+*/
+int task_create_ex(task_t *task, void (*start_func)(void *), void *arg, int tamanhoPilha){
+    unsigned char preempcaoAnterior = preemption;
+    int id;
+
+    PPOS_PREEMPT_DISABLE
+    if(tamanhoPilha > 0){
+        pilhaPedida = pilhaAloca(tamanhoPilha, &tamanhoPilhaPedida);
+        if(pilhaPedida == NULL){
+            preemption = preempcaoAnterior;
+            return -1;
+        }
     }
-    
-    //tarefa auxiliar para iterar a fila circular
-    task_t *tarefaAux = readyQueue;
 
-    //ponteiro para a proxima tarefa a executar
-    task_t *proximaTarefa = readyQueue;
+    id = task_create(task, start_func, arg);
 
-    int menorTempoRestante;
-    int tempoRestanteAtual;
-    
-    //o menor tempo restante, primeiramente, é o tempo 
-    //restante da primeira tarefa da fila
-    menorTempoRestante = task_get_ret(proximaTarefa);
+    //o núcleo falhou antes do makecontext: a pilha pedida volta ao conjunto
+    if(pilhaPedida != NULL){
+        pilhaGuarda(pilhaPedida, tamanhoPilhaPedida);
+        pilhaPedida = NULL;
+    }
 
-    
+    preemption = preempcaoAnterior;
+    return id;
+}
+
+
+/*
+Descritores alocados pelo núcleo (task_spawn). Os TCBs são reservados em
+blocos de DESCRITORES_POR_BLOCO, contíguos e alinhados à linha de cache, e
+os devolvidos por task_release ficam numa lista livre encadeada pelo campo
+next (um TCB livre não está em nenhuma fila). O identificador de um
+descritor devolvido também é reaproveitado pela próxima tarefa criada com
+task_spawn, para que os IDs não cresçam sem limite com tarefas de vida curta.
+*/
+#define DESCRITORES_POR_BLOCO 64
 
-    while(tarefaAux->next != readyQueue){
+task_t *descritoresLivres = NULL;
 
-        tarefaAux = tarefaAux->next;
+//identificadores dos descritores devolvidos, usados como uma pilha
+int *idsLivres = NULL;
+int numIdsLivres = 0;
+int capacidadeIdsLivres = 0;
 
-        tempoRestanteAtual = task_get_ret(tarefaAux);
+//descritor que o task_spawn está criando (reconhecido no after_task_create)
+task_t *descritorPedido = NULL;
 
-        if(tempoRestanteAtual < menorTempoRestante){
-            menorTempoRestante = tempoRestanteAtual;
-            proximaTarefa = tarefaAux;
+//descritor da última tarefa liberada que terminou: o dispatcher ainda o usa
+//logo após a troca de contexto, então ele só é devolvido depois (descritorDevolvePendente)
+task_t *descritorTerminado = NULL;
+
+
+//retira um descritor zerado da lista livre, reservando um novo bloco se ela estiver vazia
+task_t *descritorAloca(){
+    task_t *task;
+    int i;
+
+    if(descritoresLivres == NULL){
+        task_t *bloco = aligned_alloc(_Alignof(task_t), DESCRITORES_POR_BLOCO * sizeof(task_t));
+
+        if(bloco == NULL){
+            perror("Erro ao alocar os descritores de tarefas: ");
+            return NULL;
         }
 
-        //se a tarefa a ser mandada para o processador é crítica (dispacher)
-        //então, ela não poderá ser preemptada no tratador
-        if(proximaTarefa == taskDisp){
-            proximaTarefa->tarefaCritica = 1;
+        for(i = DESCRITORES_POR_BLOCO - 1; i >= 0; i--){
+            bloco[i].next = descritoresLivres;
+            descritoresLivres = &bloco[i];
+        }
+    }
+
+    task = descritoresLivres;
+    descritoresLivres = task->next;
+    memset(task, 0, sizeof(task_t));
+
+    return task;
+}
+
+
+//devolve um descritor à lista livre, guardando o seu identificador para reuso
+void descritorDevolve(task_t *task){
+    if(numIdsLivres == capacidadeIdsLivres){
+        int novaCapacidade = (capacidadeIdsLivres == 0) ? 64 : 2 * capacidadeIdsLivres;
+        int *novosIds = realloc(idsLivres, novaCapacidade * sizeof(int));
+
+        //sem memória o identificador apenas deixa de ser reaproveitado
+        if(novosIds != NULL){
+            idsLivres = novosIds;
+            capacidadeIdsLivres = novaCapacidade;
         }
     }
+    if(numIdsLivres < capacidadeIdsLivres)
+        idsLivres[numIdsLivres++] = task->id;
+
+    task->descritorDoNucleo = 0;
+    task->next = descritoresLivres;
+    descritoresLivres = task;
+}
+
+
+//devolve o descritor da última tarefa liberada que terminou;
+//só pode ser chamada depois que o dispatcher terminou de usá-lo (p.ex. no scheduler)
+void descritorDevolvePendente(){
+    if(descritorTerminado == NULL)
+        return;
+
+    descritorDevolve(descritorTerminado);
+    descritorTerminado = NULL;
+}
+
+
+/*
+Cria uma tarefa cujo descritor é alocado pelo núcleo e devolve esse
+descritor (ou NULL em caso de erro). A preempção fica desabilitada durante a
+criação: o after_task_create reconhece o descritor e lhe dá um ID
+reaproveitado.
+*/
+task_t * task_spawn(void (*start_func)(void *), void *arg){
+    unsigned char preempcaoAnterior = preemption;
+    task_t *task;
+
+    PPOS_PREEMPT_DISABLE
+
+    task = descritorAloca();
+    if(task == NULL){
+        preemption = preempcaoAnterior;
+        return NULL;
+    }
+
+    descritorPedido = task;
+    if(task_create(task, start_func, arg) < 0){
+        descritorPedido = NULL;
+        task->next = descritoresLivres;
+        descritoresLivres = task;
+        preemption = preempcaoAnterior;
+        return NULL;
+    }
+
+    preemption = preempcaoAnterior;
+    return task;
+}
+
+
+/*
+Devolve ao núcleo o descritor de uma tarefa criada com task_spawn. Se ela
+já terminou o descritor é reaproveitado imediatamente; senão isso acontece
+quando ela terminar (before_task_exit).
+*/
+int task_release(task_t *task){
+    unsigned char preempcaoAnterior = preemption;
+
+    if(task == NULL || task->descritorDoNucleo == 0 || task->liberarAoTerminar)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE
+
+    //'x' é o estado que o task_exit do núcleo atribui à tarefa terminada
+    if(task->state == 'x')
+        descritorDevolve(task);
+    else
+        task->liberarAoTerminar = 1;
+
+    preemption = preempcaoAnterior;
+    return 0;
+}
+
+
+/*
+Eventos dos tratadores de sinais. Com uma tarefa no processador, os
+tratadores não mexem nas filas do núcleo nem no heap de prontas: o do
+temporizador conta o tempo (systemTime, running_time e quantum) e cobra o
+orçamento da tarefa de tempo real e a quota dos grupos da tarefa corrente
+(um passo por grupo acima dela); os despertares vencem nele sem que nada seja
+movido, e os inícios de período das tarefas de tempo real e dos grupos com
+limite de banda também só vencem. As outras fontes (conclusão de uma
+operação do disco, de um trabalho paralelo ou de uma espera) só empilham a
+tarefa a acordar na pilha sem bloqueio trabalhosConcluidos (tarefaConclui).
+Todo esse trabalho fica para o dispatcher, que o processa em lote antes de
+escolher a próxima tarefa: avança a roda de temporização até systemTime (os
+ticks acumulados de uma vez), acorda as tarefas vencidas e as entregues, na
+ordem de entrega, e inicia os períodos vencidos (tempoRealLibera e
+grupoRecarrega). O tratador só verifica, em tempo constante, se há evento
+(eventosVencidos) ou período (periodosVencidos) vencido: numa política
+preemptiva a tarefa corrente cede o processador para o dispatcher
+processá-lo; nas demais, ele espera a próxima troca de contexto.
+A exceção é o dispatcher ocioso, que não chama o escalonador e gira num laço
+do núcleo sem ponto de extensão: aí é o tratador que leva à sleepQueue as
+tarefas dos eventos vencidos, num tempo proporcional a elas (veja
+ociosoEspera), e só quando nenhuma fila está sendo manipulada.
+*/
+
+//diferente de zero se há despertar vencido na roda ou tarefa entregue por
+//um tratador ou por uma thread trabalhadora
+int eventosVencidos(){
+    return atomic_load_explicit(&trabalhosConcluidos, memory_order_relaxed) != NULL
+           || (tarefasNaRoda > 0 && (int) (systemTime - proximoDespertar) >= 0);
+}
+
+
+//diferente de zero se começou o período de uma tarefa de tempo real ou de
+//um grupo com limite de banda, que o dispatcher inicia (tempoRealLibera e
+//grupoRecarrega)
+int periodosVencidos(){
+    return (listaTempoReal != NULL && (int) (systemTime - proximaLiberacaoTempoReal) >= 0)
+           || systemTime >= proximaRecargaGrupos;
+}
+
+
+//leva à sleepQueue, já vencidas, as tarefas dos eventos pendentes
+void eventosRecolhe(){
+    filasEmUso++;
+    rodaAvanca();
+    trabalhosAcorda();
+    if(tarefasNaRoda > 0)
+        proximoDespertar = systemTime + rodaProximoEvento();
+    filasEmUso--;
+}
+
+
+//no dispatcher: processa os eventos pendentes e acorda as tarefas vencidas
+void eventosProcessa(){
+    task_t *task, *proxima;
+    int restantes;
+
+    if(!eventosVencidos())
+        return;
+
+    eventosRecolhe();
+
+    for(task = sleepQueue, restantes = QUEUE_SIZE(sleepQueue); restantes > 0; task = proxima, restantes--){
+        proxima = task->next;
+        if(task->awakeTime <= systemTime)
+            task_resume(task);
+    }
+}
+
+
+/*
+Devolve um ponteiro para a próxima tarefa a receber o processador: a tarefa
+pronta de menor chave na política em uso, que está sempre no topo do heap. A tarefa
+só sai do heap quando o dispatcher efetivamente a despacha (before_task_switch)*/
+task_t * scheduler() {
+
+    task_t *proximaTarefa, *vencida;
+    taskgroup_t *estrangulador;
+
+    //o dispatcher já saiu da pilha da tarefa que terminou
+    pilhaDevolve();
+    descritorDevolvePendente();
+
+    eventosProcessa();
+
+    tempoRealLibera();
+    grupoRecarrega();
+
+    //as tarefas de grupos estrangulados que chegam ao topo ficam retidas
+    while(tamanhoHeap > 0 && (estrangulador = grupoEstrangulador(heapProntas[1].task)) != NULL){
+        proximaTarefa = heapProntas[1].task;
+        heapRemove(proximaTarefa);
+        grupoEstaciona(proximaTarefa, estrangulador);
+    }
+
+    if(politica->antesEscolha != NULL)
+        politica->antesEscolha();
+
+    //a tarefa que venceu a espera máxima também fica retida no grupo
+    //estrangulado, mesmo sem estar no topo
+    while((vencida = srtfEsperaVencida()) != NULL
+          && (estrangulador = grupoEstrangulador(vencida)) != NULL){
+        heapRemove(vencida);
+        grupoEstaciona(vencida, estrangulador);
+    }
+
+    if (readyQueue == NULL || tamanhoHeap == 0) {
+        return NULL;
+    }
+
+    proximaTarefa = heapProntas[1].task;
+
+    //no SRTF, a tarefa que esperou esperaMaxima ms passa à frente das que
+    //não são de tempo real
+    if(vencida != NULL && !CHAVE_EH_TEMPO_REAL(heapProntas[1].chave))
+        proximaTarefa = vencida;
+
+    //se a tarefa a ser mandada para o processador é crítica (dispacher)
+    //então, ela não poderá ser preemptada no tratador
+    if(proximaTarefa == taskDisp){
+        proximaTarefa->tarefaCritica = 1;
+    }
 
     //a tarefa vai receber o processador
     proximaTarefa->ativacoes++;
@@ -113,69 +3380,320 @@ task_t * scheduler() {
     return proximaTarefa;
 }
 
+//diferente de zero enquanto o tratador espera com o processador ocioso (veja
+//ociosoEspera)
+volatile int ocioso = 0;
+
+#ifdef TICKLESS
+
+//instante do relógio monotônico (em ns) até o qual o tempo já foi contabilizado
+long long relogioContabilizado;
+
+//impede que o tratador contabilize o mesmo intervalo que um hook está contabilizando
+volatile int atualizandoRelogio = 0;
+
+
+//devolve o valor do relógio monotônico do sistema, em nanossegundos
+long long relogioMonotonico(){
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+
 /*
-Incrementa o tempo de espera para todas as tarefas da fila de prontas
-ou seja, todas as tarefas que não estão executando na CPU
+Avança systemTime pelos milissegundos inteiros decorridos desde a última
+contabilização, cobrando-os da tarefa corrente (running_time e quantum).
+A fração de milissegundo que sobra fica para a próxima chamada.
 */
-void incrementaTempoDeEspera(){
+void contabilizaTempo(){
+    int decorrido = (relogioMonotonico() - relogioContabilizado) / 1000000;
 
-    task_t *tarefaAux = readyQueue;
+    if(decorrido <= 0)
+        return;
 
-    //verifica se a fila nao esta vazia
-    if(readyQueue != NULL){
-    
-        tarefaAux = tarefaAux->next;
+    relogioContabilizado += (long long) decorrido * 1000000LL;
+    systemTime += decorrido;
+    taskExec->running_time += decorrido;
+    grupoCobra(taskExec, decorrido);
 
-        while(tarefaAux != readyQueue){
+    if(taskExec->tarefaCritica == 0){
+        taskExec->quantum -= decorrido;
+        tempoRealCobra(taskExec, decorrido);
+    }
+}
 
-            tarefaAux->tempoDeEspera++;
 
-            tarefaAux = tarefaAux->next;
-        }
+/*
+Programa um único disparo do temporizador para o primeiro evento que
+interessa enquanto a tarefa task estiver no processador: o fim do seu
+quantum (se for tarefa de usuário) ou o despertar de uma tarefa adormecida.
+Sem nenhum evento pendente o temporizador fica desarmado.
+*/
+void programaTemporizador(task_t *task){
+    int intervalo = INT_MAX;
+
+    //numa política que não é preemptiva, o despertar que vence espera a
+    //próxima troca de contexto
+    if(tarefasNaRoda > 0 && (task == taskDisp || politicaPreemptiva()))
+        intervalo = proximoDespertar - systemTime;
+
+    if(task->tarefaCritica == 0 && task->quantum < intervalo)
+        intervalo = task->quantum;
+
+    //fim do orçamento da tarefa de tempo real e início do próximo período
+    if(task->tempoReal && task->orcamentoRestante > 0 && task->orcamentoRestante < intervalo)
+        intervalo = task->orcamentoRestante;
+    if(listaTempoReal != NULL
+       && (int) (proximaLiberacaoTempoReal - systemTime) < intervalo)
+        intervalo = proximaLiberacaoTempoReal - systemTime;
+
+    //fim da quota dos grupos da tarefa e início do próximo período de um
+    //grupo; numa política que não é preemptiva, a recarga espera a próxima
+    //troca de contexto
+    if(task->tarefaCritica == 0 && grupoFolga(task) < intervalo)
+        intervalo = grupoFolga(task);
+    if(proximaRecargaGrupos != UINT_MAX && (task == taskDisp || politicaPreemptiva())
+       && (int) (proximaRecargaGrupos - systemTime) < intervalo)
+        intervalo = proximaRecargaGrupos - systemTime;
+
+    //evento vencido que ainda não tomou o processador (preempção adiada)
+    if(task->tarefaCritica == 0 && politicaPreemptiva()
+       && (sleepQueue != NULL || trabalhosConcluidos != NULL))
+        intervalo = 0;
+
+    //o dispatcher sem tarefas prontas: um disparo logo em seguida permite ao
+    //tratador suspender o processo (veja ociosoEspera). Os disparos continuam
+    //até ele suspender: o que cai no meio da troca para o dispatcher não o
+    //faz, e sem disparos o dispatcher giraria sem recolher as tarefas
+    //entregues
+    if(task == taskDisp && readyQueue == NULL && !ocioso)
+        intervalo = 1;
+
+    //evento já vencido (p.ex. preempção adiada): tenta de novo em 1 ms
+    if(intervalo < 1)
+        intervalo = 1;
+
+    timer.it_interval.tv_sec  = 0;
+    timer.it_interval.tv_usec = 0;
+    timer.it_value.tv_sec  = (intervalo == INT_MAX) ? 0 : intervalo / 1000;
+    timer.it_value.tv_usec = (intervalo == INT_MAX) ? 0 : (intervalo % 1000) * 1000;
+
+    if (setitimer (ITIMER_REAL, &timer, 0) < 0)
+    {
+        perror ("Erro em setitimer: ") ;
+        exit (1) ;
+    }
+}
+
+#endif
+
+
+/*
+Processador ocioso. Sem tarefas prontas, o dispatcher do núcleo gira num
+laço consultando systime() até que uma tarefa adormecida desperte. O laço
+não tem ponto de extensão, então é o tratador que, ao interromper o
+dispatcher sem trabalho, suspende o processo (sigsuspend) até o próximo
+sinal: o disparo do temporizador, a conclusão de uma operação do disco
+(SIGIO e SIGUSR1) ou o aviso de uma thread trabalhadora. Os tratadores
+desses sinais executam normalmente durante a espera, que termina quando uma
+tarefa fica pronta ou um despertar vence. O tempo ocioso não é cobrado do
+dispatcher: ele é somado à parte e informado quando o dispatcher termina.
+*/
+
+//tempo (em ms) e número de períodos em que o processador ficou ocioso
+unsigned int tempoOcioso = 0;
+int periodosOciosos = 0;
+
+
+//devolve 1 se o dispatcher tem o que fazer: despachar uma tarefa pronta,
+//acordar uma tarefa cujo despertar venceu ou terminar o sistema; a tarefa
+//escolhida sai da readyQueue antes da troca e só deixa o heap no
+//before_task_switch: o heap não vazio indica um despacho em curso (daí até
+//o fim da troca, o tratador não chama ociosoEspera)
+int dispatcherTemTrabalho(){
+    task_t *task = sleepQueue;
+
+    if(readyQueue != NULL || tamanhoHeap > 0 || countTasks <= 0)
+        return 1;
+
+    if(task != NULL){
+        do{
+            if(task->awakeTime <= systemTime)
+                return 1;
+            task = task->next;
+        } while(task != sleepQueue);
+    }
+    return 0;
+}
+
 
-        //para a primeira tarefa da fila
-        tarefaAux->tempoDeEspera++;
+//no tratador: suspende o processo enquanto o dispatcher interrompido não
+//tem o que fazer
+void ociosoEspera(){
+    sigset_t sinais, anterior, espera;
+    unsigned int inicio;
 
+    //as filas só são consultadas fora de uma manipulação delas
+    if(ocioso || taskExec != taskDisp || filasEmUso != 0)
+        return;
+
+    //os sinais do disco ficam bloqueados entre a consulta e o sigsuspend,
+    //para que uma conclusão nesse intervalo não se perca (o SIGALRM já está
+    //bloqueado durante o tratador)
+    sigemptyset(&sinais);
+    sigaddset(&sinais, SIGIO);
+    sigaddset(&sinais, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &sinais, &anterior);
+    espera = anterior;
+    sigdelset(&espera, SIGALRM);
+    sigdelset(&espera, SIGIO);
+    sigdelset(&espera, SIGUSR1);
+
+    ocioso = 1;
+    inicio = systemTime;
+
+    //sem tarefas prontas o dispatcher não chama o escalonador: os eventos
+    //vão para a sleepQueue aqui mesmo, e o dispatcher acorda as tarefas
+    eventosRecolhe();
+    if(!dispatcherTemTrabalho()){
+        periodosOciosos++;
+        do{
+            sigsuspend(&espera);
+            eventosRecolhe();
+        } while(!dispatcherTemTrabalho());
     }
+
+#ifdef TICKLESS
+    contabilizaTempo();
+#endif
+
+    //os tratadores aninhados cobraram a espera do dispatcher
+    taskDisp->running_time -= systemTime - inicio;
+    tempoOcioso += systemTime - inicio;
+    ocioso = 0;
+
+    sigprocmask(SIG_SETMASK, &anterior, NULL);
 }
 
 
 /*
 a cada disparo do temporizador, o tratador decrementa o quantum e
-incrementa o running_time da tarefa corrente. Além disso, incrementa
-o tempo de espera das demais tarefas 
+incrementa o running_time da tarefa corrente. O tempo de espera das
+demais tarefas não é mais percorrido aqui: ele é acumulado quando cada
+tarefa sai da fila de prontas (heapRemove), e o tratador faz trabalho constante
 */
 void tratador(){
+    int emTroca;
+
+#ifdef TICKLESS
+    //um hook está contabilizando o tempo e vai reprogramar o temporizador
+    if(atualizandoRelogio)
+        return;
+
+    emTroca = trocaEmAndamento();
+
+    contabilizaTempo();
+
+    //o heap só é consultado com a preempção ativa (fora de uma atualização
+    //dele); os períodos vencidos são iniciados pelo dispatcher
+    if(taskExec->tarefaCritica == 0 && PPOS_IS_PREEMPT_ACTIVE && !emTroca
+       && (taskExec->quantum <= 0 || prontaMaisUrgente()
+           || (politicaPreemptiva() && (eventosVencidos() || periodosVencidos())))){
+        //só a fatia esgotada é renovada; a tarefa preemptada por outra mais
+        //urgente guarda o que lhe resta. O temporizador da próxima tarefa é
+        //programado na troca de contexto
+        if(taskExec->quantum <= 0){
+            if(politica->quantumEsgotado != NULL)
+                politica->quantumEsgotado(taskExec);
+            taskExec->quantum = politica->quantum(taskExec);
+        }
+#ifdef FASTSWITCH
+        sigprocmask(SIG_UNBLOCK, &sinaisTemporizador, NULL);
+#endif
+        task_yield();
+        return;
+    }
+
+    programaTemporizador(taskExec);
+
+    //no meio de um despacho o dispatcher tem trabalho (veja dispatcherTemTrabalho)
+    if(!emTroca)
+        ociosoEspera();
+#else
+    emTroca = trocaEmAndamento();
 
-    //contador global do sistema é incrementado 
+    //contador global do sistema é incrementado; os despertares que vencem
+    //neste tick ficam para o dispatcher (veja eventosProcessa)
     systemTime++;
+
+    //o tempo de processador é cobrado dos grupos da tarefa corrente; um
+    //grupo que esgota a quota zera o quantum da tarefa
+    grupoCobra(taskExec, 1);
     
     //a rotina de tratamento de ticks de relógio deve decrementar o contador de
     //quantum da tarefa corrente, se for uma tarefa de usuário
     if(taskExec->tarefaCritica == 0){
+        //uma tarefa de tempo real que esgota o orçamento tem o quantum zerado
+        tempoRealCobra(taskExec, 1);
+
         //se quantum esgotou, então a tarefa corrente é preemptada
         if(taskExec->quantum == 0){
-            //antes da preempção, setamos o quantum da tarefa pro valor definido
-            taskExec->quantum = QUANTUM;
-            task_yield();
+            //com a preempção desabilitada (p.ex. durante uma atualização do
+            //heap de prontas) ou no meio de uma troca de contexto, a troca
+            //fica adiada para o próximo tick
+            if(PPOS_IS_PREEMPT_ACTIVE && !emTroca){
+                //antes da preempção, setamos o quantum da tarefa pro valor
+                //definido pela política (que pode rebaixá-la antes)
+                if(politica->quantumEsgotado != NULL)
+                    politica->quantumEsgotado(taskExec);
+                taskExec->quantum = politica->quantum(taskExec);
+#ifdef FASTSWITCH
+                //a troca rápida não restaura a máscara de sinais: o SIGALRM,
+                //bloqueado durante o tratador, é liberado antes da troca
+                sigprocmask(SIG_UNBLOCK, &sinaisTemporizador, NULL);
+#endif
+                task_yield();
+            }
         }
         else{
             taskExec->quantum--;
+
+            //numa política preemptiva, uma tarefa mais urgente que ficou
+            //pronta, ou um despertar ou período vencido que o dispatcher vai
+            //processar, toma o processador; a corrente guarda o que lhe resta
+            //do quantum
+            if(PPOS_IS_PREEMPT_ACTIVE && !emTroca
+               && (prontaMaisUrgente()
+                   || (politicaPreemptiva() && (eventosVencidos() || periodosVencidos())))){
+#ifdef FASTSWITCH
+                sigprocmask(SIG_UNBLOCK, &sinaisTemporizador, NULL);
+#endif
+                task_yield();
+            }
         }
     }
 
-    
-
-    incrementaTempoDeEspera();
     //incrementando o tempo de execução no processador
     taskExec->running_time++;
 
+    if(!emTroca)
+        ociosoEspera();
+#endif
+
 }
 
 
 void after_task_create (task_t *task ) {
     // put your customization here
-    task->quantum = QUANTUM;
+    int i;
+
+    task->prioridade = 0;
+    task->nivel = 0;
+    task->geracaoReforco = geracaoReforco;
+    task->fatia = fatiaInicial();
+    task->quantum = politica->quantum(task);
     task->running_time = 0;
     task->tempoEstimado = 99999;
     task->tempoRestante = 0;
@@ -183,6 +3701,50 @@ void after_task_create (task_t *task ) {
     task->tarefaCritica = 0;
     task->ativacoes = 0;
     task->inicio = systime();
+    task->posicaoHeap = 0;
+    task->tempoReal = 0;
+    task->proxTempoReal = NULL;
+    task->passe = 0;
+    task->tempoVirtual = 0;
+    task->grupo = NULL;
+    task->estacionadaEm = NULL;
+    task->proxEstacionada = NULL;
+    task->ativaNoGrupo = 0;
+    task->afinidade = ~0UL;
+    task->ultimaTrabalhadora = -1;
+    task->migracoes = 0;
+    task->objetoComunicacao = NULL;
+    task->mutexesDetidos = NULL;
+    task->mutexEsperado = NULL;
+    for(i = 0; i < LEITURAS_MAX; i++)
+        task->leituras[i].rw = NULL;
+    task->chaveHerdada = LONG_MAX;
+    task->estimativaAutomatica = 1;
+    task->rajadaPrevista = RAJADA_INICIAL;
+    task->inicioRajada = -1;
+    task->rajadas = 0;
+    task->erroPrevisao = 0;
+    task->liberarAoTerminar = 0;
+
+    //um descritor do task_spawn herda o identificador de um descritor devolvido
+    task->descritorDoNucleo = (task == descritorPedido);
+    if(task->descritorDoNucleo){
+        descritorPedido = NULL;
+        if(numIdsLivres > 0)
+            task->id = idsLivres[--numIdsLivres];
+    }
+
+    //o núcleo já colocou a tarefa na readyQueue; o dispatcher é retirado
+    //dela logo em seguida pelo ppos_init, por isso não entra no heap
+    if(task == taskDisp){
+        task->tarefaCritica = 1;
+    }
+    else{
+        heapInsere(task);
+    }
+
+    criandoTarefa = 0;
+    preemption = preempcaoCriacao;
 
 #ifdef DEBUG
     printf("\ntask_create - AFTER - [%d]", task->id);
@@ -194,9 +3756,18 @@ void after_ppos_init () {
     
     systemTime = 0;
 
+    //a thread do PPOS recebe os avisos das trabalhadoras e do disco (tarefaConclui)
+    threadPPOS = pthread_self();
+
     //taskMain só será mandada ao processador, caso não exista mais tarefas de usuario na fila
     task_set_eet(taskMain, 99999);
 
+    //o descritor da main não passa pelo after_task_create
+    taskMain->afinidade = ~0UL;
+    taskMain->ultimaTrabalhadora = -1;
+    taskMain->fatia = fatiaInicial();
+    taskMain->chaveHerdada = LONG_MAX;
+
     // registra a ação para o sinal de timer SIGALRM
     action.sa_handler = tratador;
     sigemptyset (&action.sa_mask);
@@ -207,6 +3778,15 @@ void after_ppos_init () {
         exit (1);
     }
 
+#ifdef FASTSWITCH
+    sigemptyset (&sinaisTemporizador);
+    sigaddset (&sinaisTemporizador, SIGALRM);
+#endif
+
+#ifdef TICKLESS
+    //o primeiro disparo é programado quando o dispatcher assumir o processador
+    relogioContabilizado = relogioMonotonico();
+#else
     // ajusta valores do temporizador
     timer.it_value.tv_usec = 1000;      // primeiro disparo, em micro-segundos
     timer.it_value.tv_sec  = 0;      // primeiro disparo, em segundos
@@ -219,6 +3799,7 @@ void after_ppos_init () {
         perror ("Erro em setitimer: ") ;
         exit (1) ;
     }
+#endif
 
 
 #ifdef DEBUG
@@ -228,6 +3809,33 @@ void after_ppos_init () {
 
 
 void before_task_exit () {
+    int i;
+
+    //a tarefa que está terminando não pode mais ser preemptada: o task_yield
+    //do tratador a devolveria para a fila de prontas
+    taskExec->tarefaCritica = 1;
+
+    //a pilha só volta para o conjunto quando o dispatcher assumir; o free
+    //que o dispatcher faz da pilha da tarefa terminada passa a receber NULL
+    if(taskExec->context.uc_stack.ss_sp != NULL){
+        pilhaDevolve();
+        pilhaTerminada = taskExec->context.uc_stack.ss_sp;
+        tamanhoPilhaTerminada = taskExec->context.uc_stack.ss_size;
+        taskExec->context.uc_stack.ss_sp = NULL;
+    }
+
+    //da mesma forma, o descritor liberado só volta para o núcleo depois da troca
+    if(taskExec->liberarAoTerminar){
+        descritorDevolvePendente();
+        descritorTerminado = taskExec;
+    }
+
+    //as leituras de rwlock que a tarefa ainda detém continuam contando em
+    //leitores (como o mutex que fica com o dono), mas saem das listas dos
+    //rwlocks, pois o TCB pode ser reaproveitado
+    for(i = 0; i < LEITURAS_MAX; i++)
+        if(taskExec->leituras[i].rw != NULL)
+            leituraRetira(&taskExec->leituras[i]);
     
     if(taskExec->running_time == taskExec->tempoEstimado)
         printf("\nTarefa %d acabou sua execução", taskExec->id);
@@ -235,6 +3843,42 @@ void before_task_exit () {
     printf("\nTask %d exit: execution time %d ms, processor time %d ms, %d activations \n", 
             taskExec->id, taskExec->running_time + taskExec->tempoDeEspera, taskExec->running_time, taskExec->ativacoes);
 
+    //para as tarefas de tempo real, os prazos cumpridos e perdidos
+    if(taskExec->tempoReal){
+        if(taskExec->trabalhoPendente && (int) (systemTime - taskExec->prazoAbsoluto) > 0)
+            taskExec->perdasPrazo++;
+        printf("Task %d deadlines: %d jobs, %d missed\n",
+                taskExec->id, taskExec->trabalhos, taskExec->perdasPrazo);
+        tempoRealRetira(taskExec);
+    }
+
+    //com a fatia adaptativa, a fatia final e o tempo de processador por ativação
+    if(fatiaAdaptativa() && taskExec != taskDisp && taskExec->ativacoes > 0)
+        printf("Task %d quantum: final slice %d ms, %.1f ms of processor per activation\n",
+                taskExec->id, taskExec->fatia, (double) taskExec->running_time / taskExec->ativacoes);
+
+    //para o dispatcher, o tempo em que o processador ficou ocioso
+    if(taskExec == taskDisp)
+        printf("Dispatcher idle time: %u ms in %d idle periods\n", tempoOcioso, periodosOciosos);
+
+    //para as tarefas que executaram trabalhos paralelos, as migrações
+    if(taskExec->ultimaTrabalhadora >= 0)
+        printf("Task %d migrations: %d (last worker %d)\n",
+                taskExec->id, taskExec->migracoes, taskExec->ultimaTrabalhadora);
+
+    //a tarefa deixa o seu grupo
+    if(taskExec->grupo != NULL){
+        grupoDesativa(taskExec);
+        taskExec->grupo->membros--;
+        taskExec->grupo = NULL;
+    }
+
+    //para as tarefas sem task_set_eet, a qualidade da estimativa das rajadas
+    rajadaTermina(taskExec);
+    if(taskExec->estimativaAutomatica && taskExec->rajadas > 0)
+        printf("Task %d bursts: %d, mean absolute prediction error %.1f ms\n",
+                taskExec->id, taskExec->rajadas, (double) taskExec->erroPrevisao / taskExec->rajadas);
+
 #ifdef DEBUG
     printf("\ntask_exit - BEFORE- [%d]", taskExec->id);
 #endif
@@ -247,6 +3891,29 @@ void before_task_exit () {
 void before_ppos_init () {
     // put your customization here
 
+    //sem ppos_set_scheduler, a política vem do ambiente (o padrão é o SRTF)
+    if(politica == NULL){
+        char *nome = getenv("PPOS_SCHED");
+        int i;
+
+        politica = &politicaSRTF;
+        for(i = 0; nome != NULL && i < NUM_POLITICAS; i++)
+            if(strcmp(nome, politicas[i]->nome) == 0)
+                politica = politicas[i];
+    }
+
+    //sem ppos_set_aging, o envelhecimento vem do ambiente ("taxa,espera")
+    if(taxaEnvelhecimento == 0 && getenv("PPOS_AGING") != NULL)
+        sscanf(getenv("PPOS_AGING"), "%d,%d", &taxaEnvelhecimento, &esperaMaxima);
+
+    //sem ppos_set_quantum, os limites da fatia vêm do ambiente ("minimo,maximo")
+    if(quantumMinimo == QUANTUM && quantumMaximo == QUANTUM && getenv("PPOS_QUANTUM") != NULL){
+        int minimo, maximo;
+
+        if(sscanf(getenv("PPOS_QUANTUM"), "%d,%d", &minimo, &maximo) == 2)
+            ppos_set_quantum(minimo, maximo);
+    }
+
 #ifdef DEBUG
     printf("\ninit - BEFORE");
 #endif
@@ -254,6 +3921,12 @@ void before_ppos_init () {
 
 void before_task_create (task_t *task ) {
     // put your customization here
+
+    //o task_create do núcleo aloca a pilha com malloc; uma preempção nesse
+    //ponto poderia levar o dispatcher a liberar memória no meio da alocação
+    preempcaoCriacao = preemption;
+    criandoTarefa = 1;
+    PPOS_PREEMPT_DISABLE
 #ifdef DEBUG
     printf("\ntask_create - BEFORE - [%d]", task->id);
 #endif
@@ -268,6 +3941,49 @@ void after_task_exit () {
 
 void before_task_switch ( task_t *task ) {
     // put your customization here
+
+    //o dispatcher retira a tarefa da readyQueue e zera task->queue antes
+    //de trocar para ela; a tarefa deixa o heap no mesmo momento
+    if(task->posicaoHeap != 0 && task->queue == NULL)
+        heapRemove(task);
+
+    //a preempção desabilitada no before_task_yield volta a valer quando o
+    //dispatcher entrega o processador para a próxima tarefa
+    if(taskExec == taskDisp)
+        PPOS_PREEMPT_ENABLE
+
+    //até o fim da troca o tratador não preempta (veja trocandoContexto)
+    trocandoContexto = 1;
+
+#ifdef TICKLESS
+    //o tempo decorrido é cobrado da tarefa que sai e o temporizador é
+    //programado para os eventos da tarefa que entra
+    atualizandoRelogio = 1;
+    contabilizaTempo();
+    programaTemporizador(task);
+    atualizandoRelogio = 0;
+#endif
+
+    //a rajada da tarefa que sai termina aqui e o tempo usado é informado à
+    //política; se a tarefa já voltou para o heap (task_yield), sua posição é
+    //corrigida pela nova chave
+    if(taskExec != taskDisp){
+        int usado = rajadaTermina(taskExec);
+
+        if(usado >= 0 && politica->usouProcessador != NULL)
+            politica->usouProcessador(taskExec, usado);
+        heapAtualiza(taskExec);
+
+        //fora do heap, a tarefa que sai bloqueou, terminou ou foi retida
+        if(taskExec->posicaoHeap == 0){
+            grupoDesativa(taskExec);
+            if(taskExec->estacionadaEm == NULL)
+                fatiaInterrompida(taskExec);
+        }
+    }
+    if(task != taskDisp)
+        rajadaInicia(task);
+
 #ifdef DEBUG
     printf("\ntask_switch - BEFORE - [%d -> %d]", taskExec->id, task->id);
 #endif
@@ -282,6 +3998,11 @@ void after_task_switch ( task_t *task ) {
 
 void before_task_yield () {
     // put your customization here 
+
+    //o task_yield do núcleo não pode ser interrompido por outro task_yield
+    //do tratador entre recolocar a tarefa na fila e trocar para o dispatcher,
+    //senão a tarefa seria despachada e depois sairia da fila de prontas
+    PPOS_PREEMPT_DISABLE
 #ifdef DEBUG
     printf("\ntask_yield - BEFORE - [%d]", taskExec->id);
 #endif
@@ -289,6 +4010,11 @@ void before_task_yield () {
 
 void after_task_yield () {
     // put your customization here
+
+    //a tarefa só volta para a fila de prontas se não estiver suspensa
+    if((task_t **) taskExec->queue == &readyQueue)
+        heapInsere(taskExec);
+
 #ifdef DEBUG
     printf("\ntask_yield - AFTER - [%d]", taskExec->id);
 #endif
@@ -296,6 +4022,21 @@ void after_task_yield () {
 
 void before_task_suspend( task_t *task ) {
     // put your customization here
+
+    filasEmUso++;
+
+    //uma tarefa pronta que é suspensa sai da readyQueue e também do heap
+    //(ou da lista de retidas do seu grupo); a tarefa corrente só deixa de
+    //contar como ativa no grupo na troca de contexto
+    if(task != NULL && task != taskExec){
+        grupoDesestaciona(task);
+        heapRemove(task);
+        grupoDesativa(task);
+    }
+    else{
+        heapRemove(taskExec);
+    }
+
 #ifdef DEBUG
     printf("\ntask_suspend - BEFORE - [%d]", task->id);
 #endif
@@ -303,6 +4044,8 @@ void before_task_suspend( task_t *task ) {
 
 void after_task_suspend( task_t *task ) {
     // put your customization here
+
+    filasEmUso--;
 #ifdef DEBUG
     printf("\ntask_suspend - AFTER - [%d]", task->id);
 #endif
@@ -310,6 +4053,12 @@ void after_task_suspend( task_t *task ) {
 
 void before_task_resume(task_t *task) {
     // put your customization here
+
+    //uma tarefa acordada antes do prazo sai da roda (o núcleo só a procura
+    //na sleepQueue, e a tarefa precisa estar desencadeada para entrar na
+    //fila de prontas)
+    filasEmUso++;
+    rodaRetira(task);
 #ifdef DEBUG
     printf("\ntask_resume - BEFORE - [%d]", task->id);
 #endif
@@ -317,6 +4066,10 @@ void before_task_resume(task_t *task) {
 
 void after_task_resume(task_t *task) {
     // put your customization here
+
+    heapInsere(task);
+    filasEmUso--;
+
 #ifdef DEBUG
     printf("\ntask_resume - AFTER - [%d]", task->id);
 #endif
@@ -324,6 +4077,13 @@ void after_task_resume(task_t *task) {
 
 void before_task_sleep () {
     // put your customization here
+
+#ifdef TICKLESS
+    //o task_sleep do núcleo calcula o despertar a partir de systime()
+    atualizandoRelogio = 1;
+    contabilizaTempo();
+    atualizandoRelogio = 0;
+#endif
 #ifdef DEBUG
     printf("\ntask_sleep - BEFORE - [%d]", taskExec->id);
 #endif
@@ -331,6 +4091,18 @@ void before_task_sleep () {
 
 void after_task_sleep () {
     // put your customization here
+    unsigned char preempcaoAnterior = preemption;
+
+    //a tarefa sai da sleepQueue e passa a aguardar o despertar na roda; se
+    //uma preempção já a fez dormir e acordar, ela não está mais na fila
+    if((task_t **) taskExec->queue == &sleepQueue){
+        PPOS_PREEMPT_DISABLE
+        filasEmUso++;
+        QUEUE_REMOVE(&sleepQueue, taskExec);
+        rodaInsere(taskExec);
+        filasEmUso--;
+        preemption = preempcaoAnterior;
+    }
 #ifdef DEBUG
     printf("\ntask_sleep - AFTER - [%d]", taskExec->id);
 #endif
@@ -382,6 +4154,8 @@ int after_sem_down (semaphore_t *s) {
 #ifdef DEBUG
     printf("\nsem_down - AFTER - [%d]", taskExec->id);
 #endif
+
+    comunicacaoRegistra(s);
     return 0;
 }
 
@@ -398,6 +4172,8 @@ int after_sem_up (semaphore_t *s) {
 #ifdef DEBUG
     printf("\nsem_up - AFTER - [%d]", taskExec->id);
 #endif
+
+    comunicacaoRegistra(s);
     return 0;
 }
 
@@ -427,6 +4203,12 @@ int before_mutex_create (mutex_t *m) {
 
 int after_mutex_create (mutex_t *m) {
     // put your customization here
+
+    m->dono = NULL;
+    m->inicioPosse = 0;
+    m->aquisicoes = m->disputas = m->esgotados = 0;
+    m->tempoPosse = m->tempoEspera = 0;
+    m->esperaMaxima = 0;
 #ifdef DEBUG
     printf("\nmutex_create - AFTER - [%d]", taskExec->id);
 #endif
@@ -475,6 +4257,14 @@ int before_mutex_destroy (mutex_t *m) {
 
 int after_mutex_destroy (mutex_t *m) {
     // put your customization here
+
+    //o dono do mutex destruído deixa de herdar das tarefas que o esperavam
+    if(m->dono != NULL){
+        task_t *dono = m->dono;
+
+        mutexDesliga(m);
+        herancaRecalcula(dono);
+    }
 #ifdef DEBUG
     printf("\nmutex_destroy - AFTER - [%d]", taskExec->id);
 #endif
@@ -558,6 +4348,8 @@ int after_mqueue_send (mqueue_t *queue, void *msg) {
 #ifdef DEBUG
     printf("\nmqueue_send - AFTER - [%d]", taskExec->id);
 #endif
+
+    comunicacaoRegistra(queue);
     return 0;
 }
 
@@ -574,6 +4366,8 @@ int after_mqueue_recv (mqueue_t *queue, void *msg) {
 #ifdef DEBUG
     printf("\nmqueue_recv - AFTER - [%d]", taskExec->id);
 #endif
+
+    comunicacaoRegistra(queue);
     return 0;
 }
 
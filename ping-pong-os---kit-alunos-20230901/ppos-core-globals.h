@@ -15,4 +15,8 @@ extern unsigned char preemption; // indica se pode haver preempcao no momento.
                                 // qualquer outro valor indica desabilitado
 extern unsigned int systemTime; // conta o tempo global do sistema, em ticks do relogio
 
+// Rotinas de ppos-core-aux.c para esperar um evento assincrono (p.ex. o disco)
+void tarefaAguarda () ;           // tira a tarefa atual de todas as filas (seguir com task_yield)
+void tarefaConclui (task_t *task) ; // devolve a tarefa ao dispatcher (seguro em tratadores de sinal)
+
 #endif
\ No newline at end of file
@@ -52,6 +52,42 @@ void before_ppos_init ();
 void after_ppos_init (); // Após o retorno dessa funcao, o PPOS troca imediatamente 
                          // o contexto para o despachante de tarefas.
 
+// políticas de escalonamento
+#define PPOS_SCHED_SRTF 0	// menor tempo restante primeiro (padrão)
+#define PPOS_SCHED_MLFQ 1	// filas multinível com realimentação
+#define PPOS_SCHED_STRIDE 2	// fração proporcional ao peso (21 - prioridade)
+#define PPOS_SCHED_CFS    3	// completamente justo (tempo virtual)
+
+// Escolhe a política de escalonamento; deve ser chamada antes do ppos_init
+// (sem ela vale a variável de ambiente PPOS_SCHED: "srtf", "mlfq", "stride"
+// ou "cfs").
+// Retorna 0 ou erro.
+int ppos_set_scheduler (int politica) ;
+
+// Configura o envelhecimento da política SRTF; deve ser chamada antes do
+// ppos_init (sem ela vale a variável de ambiente PPOS_AGING: "taxa,espera").
+// Cada ms de espera na fila de prontas desconta taxa% de ms do tempo restante
+// de uma tarefa (taxa 0 desliga o envelhecimento). Com espera > 0, a tarefa
+// que esperou espera ms é escolhida antes das demais, a que espera há mais
+// tempo primeiro; só as tarefas de tempo real passam à frente dela.
+// Retorna 0 ou erro.
+int ppos_set_aging (int taxa, int espera) ;
+
+// Configura os limites (em ms) da fatia de tempo adaptativa das políticas
+// SRTF e stride; deve ser chamada antes do ppos_init (sem ela vale a variável
+// de ambiente PPOS_QUANTUM: "minimo,maximo"). A fatia de uma tarefa dobra
+// quando ela a esgota e cai à metade quando ela bloqueia antes do fim, sempre
+// entre minimo e maximo; com minimo = maximo (o padrão, 20 ms) ela é fixa.
+// Retorna 0 ou erro.
+int ppos_set_quantum (int minimo, int maximo) ;
+
+// Liga (1) ou desliga (0) a herança de prioridade dos mutexes: o dono de um
+// mutex passa a valer, no escalonamento, tanto quanto a tarefa mais urgente
+// que o espera (também através de uma cadeia de donos que esperam outros
+// mutexes), até liberá-lo. Ligada por padrão.
+// Retorna 0 ou erro.
+int ppos_set_inheritance (int ativa) ;
+
 // gerência de tarefas =========================================================
 
 // Cria uma nova tarefa. Retorna um ID> 0 ou erro.
@@ -62,6 +98,29 @@ void before_task_create (task_t *task );
 void after_task_create (task_t *task );  // Após o retorno dessa funcao, a nova tarefa é incluída na
                                          // fila de tarefas prontas.
 
+// o before_task_create desabilita a preempção e o after_task_create a
+// restaura; se o núcleo não conseguir alocar a pilha, ele retorna sem o
+// after_task_create, e é o task_create_adapt que restaura a preempção
+int task_create_adapt (task_t *task, void (*start_func)(void *), void *arg) ;
+#define task_create(task, start_func, arg) task_create_adapt (task, start_func, arg)
+
+// Cria uma nova tarefa com uma pilha de pelo menos tamanhoPilha bytes.
+// Retorna um ID> 0 ou erro (também se a pilha não puder ser alocada).
+int task_create_ex (task_t *task,		// descritor da nova tarefa
+                    void (*start_func)(void *),	// funcao corpo da tarefa
+                    void *arg,			// argumentos para a tarefa
+                    int tamanhoPilha) ;		// tamanho minimo da pilha, em bytes
+
+// Cria uma nova tarefa com um descritor alocado pelo núcleo. Retorna o
+// descritor da tarefa ou NULL em caso de erro.
+task_t * task_spawn (void (*start_func)(void *),	// funcao corpo da tarefa
+                     void *arg) ;			// argumentos para a tarefa
+
+// Devolve ao núcleo o descritor de uma tarefa criada com task_spawn, assim
+// que ela terminar (ou imediatamente, se já terminou); depois disso a tarefa
+// não pode mais ser usada em task_join. Retorna 0 ou erro.
+int task_release (task_t *task) ;
+
 // Termina a tarefa corrente, indicando um valor de status encerramento
 void task_exit (int exitCode) ;
 void before_task_exit ();
@@ -102,9 +161,67 @@ void task_setprio (task_t *task, int prio) ;
 // retorna a prioridade estática de uma tarefa (ou a tarefa atual)
 int task_getprio (task_t *task) ;
 
+// define o tempo de execucao estimado de uma tarefa (ou da tarefa atual),
+// usado pelo escalonador SRTF
+void task_set_eet (task_t *task, int et) ;
+
+// retorna o tempo de execucao estimado de uma tarefa (ou da tarefa atual)
+int task_get_eet (task_t *task) ;
+
+// retorna o tempo restante de execucao de uma tarefa (ou da tarefa atual)
+int task_get_ret (task_t *task) ;
+
+// torna a tarefa (ou a tarefa atual) periódica de tempo real, escalonada por
+// EDF à frente das demais: a cada period ms ela recebe budget ms de
+// processador, a serem usados em até deadline ms (budget <= deadline <= period).
+// Retorna 0, ou erro se a utilização total das tarefas de tempo real
+// passaria de 100% (controle de admissão).
+int task_set_deadline (task_t *task, int period, int budget, int deadline) ;
+
+// encerra o trabalho do período corrente da tarefa de tempo real atual,
+// que fica suspensa até o início do próximo período
+void task_wait_period () ;
+
 // retorna a proxima tarefa a ser executada conforme a politica de escalonamento
 task_t * scheduler() ;
 
+// grupos de tarefas ===========================================================
+
+// cria um grupo de tarefas dentro do grupo parent (ou no nível mais alto, se
+// parent for NULL), com o peso shares entre os seus irmãos (1024 se shares <= 0);
+// as cotas valem na política CFS. Retorna 0 ou erro.
+int taskgroup_create (taskgroup_t *group, taskgroup_t *parent, int shares) ;
+
+// limita o grupo (com os seus descendentes) a quota ms de processador a cada
+// period ms; quota 0 retira o limite. Retorna 0 ou erro.
+int taskgroup_set_bandwidth (taskgroup_t *group, int period, int quota) ;
+
+// destroi um grupo sem tarefas nem grupos filhos. Retorna 0 ou erro.
+int taskgroup_destroy (taskgroup_t *group) ;
+
+// coloca a tarefa (ou a tarefa atual) no grupo indicado, ou a retira do seu
+// grupo se group for NULL. Retorna 0 ou erro.
+int task_join_group (task_t *task, taskgroup_t *group) ;
+
+// execução paralela ===========================================================
+
+// cria n threads do sistema para executar os trabalhos de task_offload
+// (só pode ser chamada uma vez). Retorna 0 ou erro.
+int ppos_set_workers (int n) ;
+
+// executa func(arg) numa thread trabalhadora, suspendendo a tarefa atual até
+// a função terminar; as demais tarefas continuam executando. A função não
+// pode chamar funções do PPOS. Retorna 0 ou erro.
+int task_offload (void (*func)(void *), void *arg) ;
+
+// define em quais trabalhadoras os trabalhos da tarefa (ou da tarefa atual)
+// podem executar: bit i para a trabalhadora i; 0 permite todas. Retorna 0 ou erro.
+int task_set_affinity (task_t *task, unsigned long mask) ;
+
+// retorna a trabalhadora que executou o último trabalho da tarefa (ou da
+// tarefa atual), ou -1 se ela não executou nenhum
+int task_get_cpu (task_t *task) ;
+
 // operações de gestão do tempo ================================================
 
 // suspende a tarefa corrente por t milissegundos
@@ -147,6 +264,16 @@ int sem_destroy (semaphore_t *s) ;
 int before_sem_destroy (semaphore_t *s) ;
 int after_sem_destroy (semaphore_t *s) ;
 
+// caminho rápido: sem disputa, sem_down e sem_up só atualizam o valor do
+// semáforo (sem hooks, filas ou trocas de contexto); compilando com
+// -DSEMHOOKS, ambos passam pelo caminho do núcleo, que chama os hooks
+#ifndef SEMHOOKS
+int sem_down_fast (semaphore_t *s) ;
+int sem_up_fast (semaphore_t *s) ;
+#define sem_down(s) sem_down_fast (s)
+#define sem_up(s)   sem_up_fast (s)
+#endif
+
 // mutexes
 
 // Inicializa um mutex (sempre inicialmente livre)
@@ -169,6 +296,71 @@ int mutex_destroy (mutex_t *m) ;
 int before_mutex_destroy (mutex_t *m) ;
 int after_mutex_destroy (mutex_t *m) ;
 
+// Tenta obter o mutex sem esperar (retorna -1 se ele está ocupado)
+int mutex_trylock (mutex_t *m) ;
+
+// Solicita o mutex esperando no máximo ms milissegundos (retorna -1 se o
+// prazo esgota antes de obtê-lo)
+int mutex_timedlock (mutex_t *m, int ms) ;
+
+// mutex adaptativo: com o dono pronto, quem encontra o mutex ocupado cede o
+// processador algumas vezes antes de esperar na fila; o mutex_unlock
+// entrega o mutex diretamente à tarefa que espera há mais tempo. Os hooks
+// de mutex_lock e mutex_unlock só valem para o mutex das barreiras, que
+// continua o do núcleo
+int mutex_lock_adapt (mutex_t *m) ;
+int mutex_unlock_adapt (mutex_t *m) ;
+#define mutex_lock(m)   mutex_lock_adapt (m)
+#define mutex_unlock(m) mutex_unlock_adapt (m)
+
+// rwlocks: vários leitores ou um único escritor. Um leitor que chega
+// espera se há escritor esperando (os escritores não passam fome); ao sair
+// um escritor, todos os leitores que esperavam são acordados de uma vez
+
+// Inicializa um rwlock (sempre inicialmente livre)
+int rwlock_create (rwlock_t *rw) ;
+
+// Solicita o rwlock para leitura (erro se a tarefa já detém LEITURAS_MAX
+// leituras)
+int rwlock_rdlock (rwlock_t *rw) ;
+
+// Solicita o rwlock para escrita
+int rwlock_wrlock (rwlock_t *rw) ;
+
+// Libera o rwlock (de leitura ou de escrita); erro se a tarefa não o detém
+int rwlock_unlock (rwlock_t *rw) ;
+
+// Destrói um rwlock, liberando as tarefas bloqueadas
+int rwlock_destroy (rwlock_t *rw) ;
+
+// variáveis de condição, usadas com os mutexes: cond_wait libera o mutex e
+// espera a condição; ao ser sinalizada, a tarefa passa direto para a fila
+// do mutex (ou o recebe, se ele está livre) e só volta a executar com o
+// mutex obtido. Todas as tarefas que esperam uma condição ao mesmo tempo
+// devem usar o mesmo mutex
+
+// Inicializa uma variável de condição
+int cond_create (cond_t *c) ;
+
+// Libera o mutex (que a tarefa deve deter) e espera a condição; retorna
+// com o mutex obtido novamente
+int cond_wait (cond_t *c, mutex_t *m) ;
+
+// Como cond_wait, esperando a condição no máximo ms milissegundos (retorna
+// -1 se o prazo esgotou, também com o mutex obtido novamente; com ms <= 0,
+// retorna -1 na hora, sem liberar o mutex)
+int cond_timedwait (cond_t *c, mutex_t *m, int ms) ;
+
+// Passa ao mutex a tarefa que espera a condição há mais tempo
+int cond_signal (cond_t *c) ;
+
+// Passa ao mutex todas as tarefas que esperam a condição
+int cond_broadcast (cond_t *c) ;
+
+// Destrói uma variável de condição; as tarefas que a esperavam retornam -1
+// (com o mutex obtido novamente)
+int cond_destroy (cond_t *c) ;
+
 // barreiras
 
 // Inicializa uma barreira
@@ -242,6 +434,8 @@ void print_tcb( task_t* task );
 #define pthread_cond_wait		FORBIDDEN
 #define pthread_cond_signal		FORBIDDEN
 #define pthread_cond_timedwait		FORBIDDEN
+#define pthread_cond_broadcast		FORBIDDEN
+#define pthread_cond_destroy		FORBIDDEN
 
 // POSIX barriers
 #define pthread_barrier_init		FORBIDDEN
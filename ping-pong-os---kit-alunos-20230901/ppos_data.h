@@ -11,7 +11,23 @@
 #include <ucontext.h>		// biblioteca POSIX de trocas de contexto
 #include "queue.h"		// biblioteca de filas genéricas
 
+#define LEITURAS_MAX 8  // leituras de rwlock que uma tarefa pode deter ao mesmo tempo
+
+// posse de uma leitura de rwlock por uma tarefa: fica no TCB e é encadeada
+// na lista de leituras do rwlock (veja rwlock_rdlock)
+typedef struct leitura_t
+{
+   struct rwlock_t *rw ;           // rwlock lido (NULL se a entrada está livre)
+   struct leitura_t *prox, *ant ;  // encadeamento na lista de leituras do rwlock
+} leitura_t ;
+
 // Estrutura que define um Task Control Block (TCB)
+// O TCB é alinhado a 64 bytes: assim os campos adicionados que o escalonador
+// consulta a cada despacho (de tarefaCritica a posicaoRoda: chave, heap e
+// roda de temporização) ocupam uma única linha de cache, longe do contexto;
+// as estatísticas (running_time, ativacoes, tempoDeEspera, inicio) ficam na
+// linha seguinte. O núcleo lê tempoRestante, que não pode mudar de posição
+// (veja os _Static_assert em ppos-core-aux.c)
 typedef struct task_t
 {
    struct task_t *prev, *next ;		// ponteiros para usar em filas
@@ -29,12 +45,78 @@ typedef struct task_t
    int tarefaCritica;         //flag que indica se a tarefa é critica (de sistema)
    int tempoEstimado;      //tempo estimado de execução de uma tarefa na cpu
    int tempoRestante;      //tempo restante para a execução da tarefa
-   int running_time;   //tempo de execução gasto pela tarefa na CPU
    int quantum;         //fatia de tempo que cada tarefa de usuario recebe
+   int posicaoHeap;     //posição da tarefa no heap de prontas (0 indica fora do heap)
+   unsigned long ordemChegada; //ordem de chegada na fila de prontas, usada no desempate
+   unsigned int entradaProntas; //instante (systemTime) em que a tarefa entrou na fila de prontas
+   struct task_t *proxRoda, *antRoda; //encadeamento na roda de temporização (task_sleep)
+   struct task_t **posicaoRoda; //lista da roda onde a tarefa está (NULL se fora da roda)
+   int running_time;   //tempo de execução gasto pela tarefa na CPU
    int ativacoes;      // número de vezes que a tarefa entrou na cpu
    int tempoDeEspera;   //tempo que a tarefa espera na fila de prontas para executar
    int inicio;
-} task_t ;
+   int descritorDoNucleo;  //1 se o TCB foi alocado pelo núcleo (task_spawn)
+   int liberarAoTerminar;  //1 se o TCB volta para o núcleo quando a tarefa terminar (task_release)
+   int prioridade;         //prioridade estática (task_setprio), de -20 (maior) a +20 (menor)
+   int nivel;              //nível da tarefa no escalonador MLFQ (0 é o de maior prioridade)
+   unsigned int geracaoReforco; //último reforço de prioridade do MLFQ aplicado à tarefa
+   long passe;             //passe da tarefa no escalonador stride (tempo virtual)
+   long tempoVirtual;      //tempo virtual da tarefa no escalonador CFS
+   long pesoProntas;       //peso com que a tarefa foi somada às prontas (CFS)
+   int fatia;              //fatia de tempo adaptativa da tarefa, em ms (SRTF e stride)
+   int estimativaAutomatica; //1 enquanto task_set_eet não foi chamada: o SRTF usa a rajada prevista
+   int rajadaPrevista;     //previsão da próxima rajada de CPU, em ms (média exponencial)
+   int inicioRajada;       //running_time no início da rajada atual (-1 fora do processador)
+   int rajadas;            //número de rajadas observadas
+   long erroPrevisao;      //soma dos erros absolutos de previsão das rajadas, em ms
+   struct task_t *proxPronta, *antPronta; //encadeamento das tarefas do heap por ordem de entrada (espera máxima do SRTF)
+   int tempoReal;          //1 se a tarefa é periódica de tempo real (task_set_deadline, EDF)
+   int periodo, orcamento, prazoRelativo; //parâmetros de tempo real, em ms
+   int orcamentoRestante;  //tempo de processador que resta ao trabalho do período corrente
+   int trabalhoPendente;   //1 enquanto o trabalho do período corrente não terminou (task_wait_period)
+   int trabalhos;          //número de períodos (trabalhos) liberados
+   int perdasPrazo;        //número de trabalhos que perderam o prazo
+   unsigned int prazoAbsoluto;    //prazo do trabalho corrente (systemTime)
+   unsigned int proximaLiberacao; //início do próximo período (systemTime)
+   struct task_t *proxTempoReal;  //encadeamento na lista de tarefas de tempo real
+   struct taskgroup_t *grupo;     //grupo da tarefa (task_join_group), NULL se nenhum
+   struct taskgroup_t *estacionadaEm; //grupo estrangulado que retém a tarefa pronta (NULL se nenhum)
+   struct task_t *proxEstacionada;    //encadeamento na lista de tarefas retidas do grupo
+   int ativaNoGrupo;       //1 se a tarefa conta como pronta ou executando no grupo
+   long pesoNoGrupo;       //peso com que a tarefa foi somada ao grupo
+   struct task_t *proxConcluida; //encadeamento na pilha de trabalhos paralelos concluídos (task_offload)
+   unsigned long afinidade;  //trabalhadoras em que os trabalhos da tarefa podem executar (bit i = trabalhadora i)
+   int ultimaTrabalhadora;   //trabalhadora que executou o último trabalho da tarefa (-1 se nenhuma)
+   int migracoes;            //número de vezes que o trabalho da tarefa trocou de trabalhadora
+   void *objetoComunicacao;  //último semáforo ou fila de mensagens usado pela tarefa
+   struct mutex_t *mutexesDetidos; //mutexes que a tarefa detém, encadeados por proxDetido
+   struct mutex_t *mutexEsperado;  //mutex em cuja fila a tarefa espera (NULL se nenhum)
+   long chaveHerdada;        //menor chave das tarefas que esperam os mutexes da tarefa (LONG_MAX se nenhuma)
+   unsigned int inicioEsperaMutex; //instante em que cond_signal/cond_broadcast passou a tarefa para o mutex
+   leitura_t leituras[LEITURAS_MAX]; //leituras de rwlock que a tarefa detém
+} __attribute__ ((aligned (64))) task_t ;
+
+// estrutura que define um grupo de tarefas: os grupos formam uma árvore, e
+// cada grupo divide o processador com os seus irmãos (e com as tarefas do
+// grupo pai) na proporção das suas cotas; o limite de banda restringe o
+// grupo a quota ms de processador a cada periodo ms
+typedef struct taskgroup_t
+{
+   struct taskgroup_t *pai;   // grupo que contém este (NULL no nível mais alto)
+   int cotas;                 // peso do grupo entre os irmãos (1024 equivale a uma tarefa de prioridade 0)
+   int periodo, quota;        // limite de banda, em ms (quota 0 indica sem limite)
+   int consumido;             // processador usado no período corrente
+   unsigned int proximaRecarga; // início do próximo período (systemTime)
+   int estrangulado;          // 1 se o grupo esgotou a quota do período
+   int ativas;                // tarefas prontas ou executando no grupo e nos seus descendentes
+   long pesoAtivo;            // soma dos pesos das tarefas e das cotas dos filhos ativos
+   int membros, filhos;       // número de tarefas e de grupos filhos
+   struct task_t *estacionadas;          // tarefas prontas retidas enquanto o grupo está estrangulado
+   struct taskgroup_t *proxComLimite;    // encadeamento na lista de grupos com limite de banda
+   int running_time;          // tempo de processador usado pelas tarefas do grupo e dos descendentes
+   int tempoDeEspera;         // tempo de espera das tarefas do grupo e dos descendentes
+   unsigned char active;
+} taskgroup_t ;
 
 // estrutura que define um semáforo
 typedef struct {
@@ -44,14 +126,47 @@ typedef struct {
     unsigned char active;
 } semaphore_t ;
 
-// estrutura que define um mutex
-typedef struct {
+// estrutura que define um mutex; os campos a partir de dono são deste
+// arquivo (o núcleo só usa os três primeiros) e são iniciados no
+// after_mutex_create
+typedef struct mutex_t {
     struct task_t *queue;
     unsigned char value;
 
     unsigned char active;
+
+    struct task_t *dono;       // tarefa que detém o mutex (NULL se livre)
+    struct mutex_t *proxDetido; // encadeamento na lista de mutexes do dono
+    unsigned int inicioPosse;  // instante (systemTime) em que o dono o adquiriu
+    int aquisicoes;            // número de aquisições
+    int disputas;              // aquisições que encontraram o mutex ocupado
+    int esgotados;             // esperas com prazo que esgotaram (mutex_timedlock)
+    long tempoPosse;           // soma dos tempos de posse, em ms
+    long tempoEspera;          // soma dos tempos de espera, em ms
+    int esperaMaxima;          // maior espera, em ms
 } mutex_t ;
 
+// estrutura que define um rwlock (vários leitores ou um escritor)
+typedef struct rwlock_t {
+    struct task_t *leitoresEsperando;   // fila dos leitores bloqueados
+    struct task_t *escritoresEsperando; // fila dos escritores bloqueados
+    struct task_t *escritor;            // escritor que detém o rwlock (NULL se nenhum)
+    int leitores;                       // leitores que detêm o rwlock
+    struct leitura_t *leituras;         // leituras em curso, nos TCBs dos leitores
+    int esperasLeitura;                 // leituras que tiveram de esperar na fila
+    int esperasEscrita;                 // escritas que tiveram de esperar na fila
+    unsigned char active;
+} rwlock_t ;
+
+// estrutura que define uma variável de condição
+typedef struct {
+    struct task_t *queue;   // tarefas esperando a condição
+    struct mutex_t *mutex;  // mutex liberado pelas tarefas que esperam
+    int sinais;             // tarefas passadas ao mutex por cond_signal/cond_broadcast
+    int esgotados;          // esperas com prazo que esgotaram (cond_timedwait)
+    unsigned char active;
+} cond_t ;
+
 // estrutura que define uma barreira
 typedef struct {
     struct task_t *queue;
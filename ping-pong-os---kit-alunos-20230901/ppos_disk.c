@@ -0,0 +1,181 @@
+// PingPongOS - PingPong Operating System
+
+// Gerente de disco. Substitui o gerente do núcleo (disk-manager.o, na
+// libppos_static.a), que reserva o descritor da tarefa gerente com o tamanho
+// original de task_t (o TCB ganhou campos em ppos_data.h) e fica girando com
+// task_yield enquanto espera o disco.
+//
+// As tarefas colocam os seus pedidos na fila do disco e ficam suspensas. A
+// tarefa gerente envia um pedido por vez ao disco e dorme, fora de todas as
+// filas, até chegar um pedido novo ou o sinal SIGUSR1 de conclusão; então
+// acorda a tarefa do pedido concluído e envia o próximo. Enquanto o disco
+// trabalha nenhuma tarefa fica pronta por causa dele, e o processador pode
+// ficar ocioso.
+
+#include <signal.h>
+#include <stdlib.h>
+#include "ppos.h"
+#include "ppos-core-globals.h"
+#include "ppos_disk.h"
+#include "disk.h"
+
+disk_t disco;
+
+//sinais do disco: o SIGIO do temporizador do disco simulado e o SIGUSR1
+//que o tratador dele gera
+sigset_t sinaisDisco;
+
+struct sigaction acaoDisco;
+
+
+//acorda o gerente, se ele está dormindo (com os sinais do disco bloqueados
+//ou no tratador do SIGUSR1)
+void gerenteAcorda(){
+    if(disco.gerenteDormindo){
+        disco.gerenteDormindo = 0;
+        tarefaConclui(&disco.gerente);
+    }
+}
+
+
+//tratador do SIGUSR1: o disco concluiu o pedido atual
+void discoTratador(int sinal){
+    disco.sinal = 1;
+    gerenteAcorda();
+}
+
+
+//conclui o pedido e acorda a tarefa que o fez, se ela já está suspensa
+void pedidoConclui(pedido_t *pedido, int resultado){
+    pedido->resultado = resultado;
+    pedido->concluido = 1;
+    if((task_t **) pedido->task->queue == &disco.suspensas)
+        task_resume(pedido->task);
+}
+
+
+//corpo da tarefa gerente do disco
+void gerenteCorpo(void *arg){
+    sigset_t anterior;
+    pedido_t *pedido;
+
+    for(;;){
+        sem_down(&disco.acesso);
+
+        //o pedido em andamento terminou
+        if(disco.sinal){
+            disco.sinal = 0;
+            if(disco.atual != NULL)
+                pedidoConclui(disco.atual, 0);
+            disco.atual = NULL;
+        }
+
+        //com o disco livre, o próximo pedido da fila é enviado a ele
+        while(disco.atual == NULL && disco.fila != NULL){
+            pedido = disco.fila;
+            QUEUE_REMOVE(&disco.fila, pedido);
+            if(disk_cmd(pedido->operacao, pedido->bloco, pedido->buffer) < 0)
+                pedidoConclui(pedido, -1);
+            else
+                disco.atual = pedido;
+        }
+
+        sem_up(&disco.acesso);
+
+        //dorme até a conclusão do pedido atual ou um pedido novo
+        PPOS_PREEMPT_DISABLE
+        sigprocmask(SIG_BLOCK, &sinaisDisco, &anterior);
+        if(!disco.sinal && (disco.atual != NULL || disco.fila == NULL)){
+            disco.gerenteDormindo = 1;
+            tarefaAguarda();
+        }
+        sigprocmask(SIG_SETMASK, &anterior, NULL);
+        PPOS_PREEMPT_ENABLE
+        task_yield();
+    }
+}
+
+
+//coloca o pedido na fila do disco e suspende a tarefa até ele terminar
+int discoPedido(int operacao, int bloco, void *buffer){
+    pedido_t pedido;
+    sigset_t anterior;
+
+    pedido.prev = pedido.next = NULL;
+    pedido.task = taskExec;
+    pedido.operacao = operacao;
+    pedido.bloco = bloco;
+    pedido.buffer = buffer;
+    pedido.resultado = 0;
+    pedido.concluido = 0;
+
+    if(sem_down(&disco.acesso) < 0)
+        return -1;
+
+    QUEUE_APPEND(&disco.fila, &pedido);
+    sigprocmask(SIG_BLOCK, &sinaisDisco, &anterior);
+    gerenteAcorda();
+    sigprocmask(SIG_SETMASK, &anterior, NULL);
+
+    sem_up(&disco.acesso);
+
+    //o gerente pode ter concluído o pedido enquanto a tarefa esteve fora
+    //do processador
+    PPOS_PREEMPT_DISABLE
+    if(!pedido.concluido)
+        task_suspend(NULL, &disco.suspensas);
+    PPOS_PREEMPT_ENABLE
+    task_yield();
+
+    return pedido.resultado;
+}
+
+
+int disk_mgr_init(int *numBlocks, int *blockSize){
+    if(disk_cmd(DISK_CMD_INIT, 0, 0) < 0)
+        return -1;
+
+    disco.numBlocks = disk_cmd(DISK_CMD_DISKSIZE, 0, 0);
+    disco.blockSize = disk_cmd(DISK_CMD_BLOCKSIZE, 0, 0);
+    if(disco.numBlocks < 0 || disco.blockSize < 0)
+        return -1;
+
+    *numBlocks = disco.numBlocks;
+    *blockSize = disco.blockSize;
+
+    disco.fila = NULL;
+    disco.atual = NULL;
+    disco.suspensas = NULL;
+    disco.sinal = 0;
+    disco.gerenteDormindo = 0;
+    sem_create(&disco.acesso, 1);
+
+    sigemptyset(&sinaisDisco);
+    sigaddset(&sinaisDisco, SIGIO);
+    sigaddset(&sinaisDisco, SIGUSR1);
+
+    acaoDisco.sa_handler = discoTratador;
+    sigemptyset(&acaoDisco.sa_mask);
+    acaoDisco.sa_flags = 0;
+    if(sigaction(SIGUSR1, &acaoDisco, 0) < 0){
+        perror("Erro em sigaction: ");
+        exit(1);
+    }
+
+    //o gerente não conta como tarefa de usuário: o sistema termina sem
+    //esperar por ele
+    task_create(&disco.gerente, gerenteCorpo, NULL);
+    countTasks--;
+
+    return 0;
+}
+
+
+int disk_block_read(int block, void *buffer){
+    return discoPedido(DISK_CMD_READ, block, buffer);
+}
+
+
+int disk_block_write(int block, void *buffer){
+    return discoPedido(DISK_CMD_WRITE, block, buffer);
+}
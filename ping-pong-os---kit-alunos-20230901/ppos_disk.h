@@ -11,10 +11,32 @@
 // a um dispositivo de entrada/saida orientado a blocos,
 // tipicamente um disco rigido.
 
+#include "ppos_data.h"
+
+// pedido de leitura ou escrita de um bloco, feito por uma tarefa
+typedef struct pedido_t
+{
+  struct pedido_t *prev, *next ;  // ponteiros para usar em filas
+  task_t *task ;                  // tarefa que fez o pedido
+  int operacao ;                  // DISK_CMD_READ ou DISK_CMD_WRITE
+  int bloco ;                     // bloco a ler ou escrever
+  void *buffer ;                  // origem ou destino dos dados
+  int resultado ;                 // 0 (sucesso) ou -1 (erro)
+  volatile int concluido ;        // 1 quando o pedido terminou
+} pedido_t ;
+
 // estrutura que representa um disco no sistema operacional
 typedef struct
 {
-  // completar com os campos necessarios
+  int numBlocks ;                 // tamanho do disco, em blocos
+  int blockSize ;                 // tamanho de cada bloco, em bytes
+  semaphore_t acesso ;            // exclusao mutua na fila de pedidos
+  pedido_t *fila ;                // pedidos aguardando o disco
+  pedido_t *atual ;               // pedido em andamento no disco
+  task_t *suspensas ;             // tarefas aguardando seus pedidos
+  task_t gerente ;                // tarefa gerente do disco
+  volatile int sinal ;            // o disco concluiu o pedido atual (SIGUSR1)
+  volatile int gerenteDormindo ;  // o gerente espera um pedido ou um sinal
 } disk_t ;
 
 // inicializacao do gerente de disco
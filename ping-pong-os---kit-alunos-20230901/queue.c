@@ -2,66 +2,295 @@
 // Definição e operações em uma fila genérica.
 // by Eduardo e Jader
 //------------------------------------------------------------------------------
+//
+// Substitui a queue.o da libppos_static.a, que confirma a pertinência do
+// elemento na remoção percorrendo a fila inteira, e cuja queue_size também
+// percorre a fila. Estas filas estão sob as filas de prontas, de tarefas
+// adormecidas, dos semáforos e do join.
+//
+// O layout de queue_t (só prev e next, no início de task_t e das demais
+// estruturas) e o apontador para o primeiro elemento, que é a própria fila,
+// estão fixados no núcleo pré-compilado; não há onde guardar o dono de um
+// elemento nem o tamanho da fila. Eles ficam numa tabela hash à parte,
+// indexada pelo endereço do elemento (endereçamento aberto, sondagem linear):
+// cada elemento guarda a fila a que pertence (o endereço do apontador da
+// fila), e o primeiro elemento de cada fila guarda também o tamanho dela.
+// Inserção, remoção e tamanho custam O(1) em média. Quando a tabela enche, ou
+// quando não há registro de um elemento, vale o caminho antigo: percorrer a
+// fila, que está sempre correta; o registro só serve de atalho.
+//
+// O núcleo mexe nas filas também dentro do tratador de sinais (p.ex. ao
+// acordar tarefas adormecidas). Uma operação que interrompe outra não toca a
+// tabela (ela pode estar no meio de uma atualização): trabalha só na fila e
+// invalida a tabela inteira, trocando a sua época, o que custa O(1).
+//
+// Com -DQUEUE_DEBUG cada operação confere a estrutura da fila, o tamanho e
+// os donos registrados percorrendo a fila, e as operações inválidas geram
+// mensagens de erro.
 
-#include "queue.h"
 #include <stdio.h>
-#include <stdlib.h>
+#include <stdatomic.h>
+#include "queue.h"
+
+#define DONOS_BITS 14
+#define DONOS      (1 << DONOS_BITS)  //posições da tabela de donos
+#define DONOS_MAX  (DONOS / 4 * 3)    //ocupação máxima, para sondagens curtas
+
+typedef struct dono_t
+{
+   queue_t *elem ;       // elemento registrado
+   queue_t **fila ;      // fila a que o elemento pertence
+   int tamanho ;         // tamanho da fila, no primeiro elemento (-1: desconhecido)
+   unsigned int epoca ;  // o registro só vale na época corrente
+} dono_t ;
+
+dono_t donos[DONOS] ;
+int numDonos = 0 ;
+unsigned int epocaDonos = 1 ;
+
+// diferente de zero durante uma operação que usa a tabela; uma operação que a
+// interrompe (num tratador de sinal) marca a tabela como inválida
+volatile int donosEmUso = 0 ;
+volatile int donosInvalidos = 0 ;
+
+#ifdef QUEUE_DEBUG
+#define queueErro(msg) fprintf (stderr, "queue: %s\n", msg)
+#else
+#define queueErro(msg)
+#endif
 
 //------------------------------------------------------------------------------
-// Insere um elemento no final da fila.
-// Condicoes a verificar, gerando msgs de erro:
-// - a fila deve existir
-// - o elemento deve existir
-// - o elemento nao deve estar em outra fila
-// - **queue é um ponteiro para um outro ponteiro que aponta para a primeira posição da fila
+// Tabela de donos
 
-void queue_append (queue_t **queue, queue_t *elem){
+// posição inicial do elemento na tabela (hash multiplicativo do endereço)
+unsigned int donoPosicao (queue_t *elem)
+{
+   return (unsigned int) ((((unsigned long) elem >> 4) * 0x9E3779B97F4A7C15UL)
+                          >> (64 - DONOS_BITS)) ;
+}
 
-    if(queue == NULL){
-        fprintf(stderr, "Fila não existe\n");
-        return -1;
-    }
+// registro do elemento, ou NULL se ele não está registrado
+dono_t *donoBusca (queue_t *elem)
+{
+   unsigned int i = donoPosicao (elem) ;
+
+   while (donos[i].epoca == epocaDonos)
+   {
+      if (donos[i].elem == elem)
+         return &donos[i] ;
+      i = (i + 1) & (DONOS - 1) ;
+   }
+   return NULL ;
+}
 
-    if(elem == NULL){
-        fprintf(stderr, "Elemento não existe\n");
-        return -2;
-    }
-    else{//verificar se elem já está na fila
+// registra o elemento (ou devolve o seu registro); NULL se a tabela está cheia
+dono_t *donoInsere (queue_t *elem)
+{
+   unsigned int i = donoPosicao (elem) ;
+
+   while (donos[i].epoca == epocaDonos)
+   {
+      if (donos[i].elem == elem)
+         return &donos[i] ;
+      i = (i + 1) & (DONOS - 1) ;
+   }
+
+   if (numDonos >= DONOS_MAX)
+      return NULL ;
+
+   donos[i].elem = elem ;
+   donos[i].epoca = epocaDonos ;
+   numDonos++ ;
+   return &donos[i] ;
+}
 
-        //ponteiro auxiliar recebe o primeiro elemento da fila
-        queue_t *aux = *queue;
+// apaga o registro, puxando para trás os registros seguintes da sequência de
+// sondagem que não podem ficar depois do buraco (os apontadores para a tabela
+// deixam de valer)
+void donoRetira (dono_t *dono)
+{
+   unsigned int i = dono - donos, j = i, k ;
+
+   for (;;)
+   {
+      j = (j + 1) & (DONOS - 1) ;
+      if (donos[j].epoca != epocaDonos)
+         break ;
+
+      // o registro em j fica onde está se a sua posição inicial k está
+      // (circularmente) entre o buraco i e j
+      k = donoPosicao (donos[j].elem) ;
+      if ((i < j) ? (i < k && k <= j) : (i < k || k <= j))
+         continue ;
+
+      donos[i] = donos[j] ;
+      i = j ;
+   }
+
+   donos[i].epoca = 0 ;
+   numDonos-- ;
+}
 
-        //verificando se o primeiro elemento da fila é igual a elem
-        if(aux == elem){
-            printf(stderr, "Elemento já está na fila");
-            return -3;
-        }
+// início de uma operação; devolve 0 se ela interrompeu outra e não pode usar
+// a tabela
+int donosEntra ()
+{
+   if (donosEmUso)
+   {
+      donosInvalidos = 1 ;
+      return 0 ;
+   }
+   donosEmUso = 1 ;
+   atomic_signal_fence (memory_order_seq_cst) ;
+
+   // uma operação interrompida mexeu em filas sem atualizar a tabela
+   if (donosInvalidos)
+   {
+      donosInvalidos = 0 ;
+      if (++epocaDonos == 0)
+         epocaDonos = 1 ;
+      numDonos = 0 ;
+   }
+   return 1 ;
+}
 
-        //verificando as demais posições
-        while(aux->next != (*queue)){
-            if(aux == elem){
-                printf(stderr, "Elemento já está na fila");
-                return -3;
-            }
-        }
+void donosSai ()
+{
+   atomic_signal_fence (memory_order_seq_cst) ;
+   donosEmUso = 0 ;
+}
 
-        //se o elem não foi encontrado, então ele está em outra fila
-        printf(stderr, "Elemento está em outra fila");
-        return -4;
+// tamanho registrado da fila (no seu primeiro elemento), ou -1
+int donoTamanho (queue_t **queue)
+{
+   dono_t *dono = donoBusca (*queue) ;
 
-    }
+   if (dono == NULL || dono->fila != queue)
+      return -1 ;
+   return dono->tamanho ;
+}
 
-    //inserindo no final da fila
+// registra o tamanho da fila no seu primeiro elemento
+void donoAtualizaTamanho (queue_t **queue, int tamanho)
+{
+   dono_t *dono = donoBusca (*queue) ;
 
-    queue_t * aux = (*queue)->prev;
-    aux->next = elem;
-    elem->prev = aux;
-    (*queue)->prev = elem;
-    elem->next = *queue;
+   if (dono != NULL && dono->fila == queue)
+      dono->tamanho = tamanho ;
+}
 
+// percorre a fila procurando o elemento
+int filaContem (queue_t *queue, queue_t *elem)
+{
+   queue_t *aux = queue ;
 
-    return 0;
+   do
+   {
+      if (aux == elem)
+         return 1 ;
+      aux = aux->next ;
+   }
+   while (aux != queue) ;
 
+   return 0 ;
+}
+
+#ifdef QUEUE_DEBUG
+// confere a estrutura da fila, o tamanho registrado e o dono dos elementos
+void filaValida (queue_t **queue)
+{
+   queue_t *aux = *queue ;
+   dono_t *dono ;
+   int n = 0 ;
+
+   if (aux == NULL)
+      return ;
+
+   do
+   {
+      if (aux->next == NULL || aux->prev == NULL
+          || aux->next->prev != aux || aux->prev->next != aux)
+      {
+         queueErro ("ponteiros errados na fila") ;
+         return ;
+      }
+      dono = donoBusca (aux) ;
+      if (dono != NULL && dono->fila != queue)
+         queueErro ("elemento registrado em outra fila") ;
+      n++ ;
+      aux = aux->next ;
+   }
+   while (aux != *queue) ;
+
+   if (donoTamanho (queue) >= 0 && donoTamanho (queue) != n)
+      queueErro ("tamanho registrado diferente do tamanho da fila") ;
+}
+#else
+#define filaValida(queue)
+#endif
+
+//------------------------------------------------------------------------------
+// Insere um elemento no final da fila.
+// Condicoes a verificar, gerando msgs de erro:
+// - a fila deve existir
+// - o elemento deve existir
+// - o elemento nao deve estar em outra fila
+
+void queue_append (queue_t **queue, queue_t *elem)
+{
+   dono_t *dono, *primeiro = NULL ;
+   int registra ;
+
+   if (queue == NULL || elem == NULL)
+   {
+      queueErro ("fila ou elemento inexistente") ;
+      return ;
+   }
+
+   // um elemento fora de qualquer fila tem os dois apontadores nulos
+   if (elem->prev != NULL || elem->next != NULL)
+   {
+      queueErro ("elemento ja esta em uma fila") ;
+      return ;
+   }
+
+   registra = donosEntra () ;
+   if (registra)
+   {
+      filaValida (queue) ;
+
+      // registro do primeiro elemento, que guarda o tamanho da fila (a
+      // inserção de um registro não move os demais)
+      if (*queue != NULL)
+         primeiro = donoBusca (*queue) ;
+   }
+
+   if (*queue == NULL)
+   {
+      elem->prev = elem->next = elem ;
+      *queue = elem ;
+   }
+   else
+   {
+      elem->prev = (*queue)->prev ;
+      elem->next = *queue ;
+      (*queue)->prev->next = elem ;
+      (*queue)->prev = elem ;
+   }
+
+   if (registra)
+   {
+      dono = donoInsere (elem) ;
+      if (dono != NULL)
+      {
+         dono->fila = queue ;
+         dono->tamanho = (*queue == elem) ? 1 : -1 ;
+      }
+      if (primeiro != NULL && primeiro->fila == queue && primeiro->tamanho >= 0)
+         primeiro->tamanho++ ;
+      filaValida (queue) ;
+      donosSai () ;
+   }
 }
 
 //------------------------------------------------------------------------------
@@ -73,78 +302,131 @@ void queue_append (queue_t **queue, queue_t *elem){
 // - o elemento deve pertencer a fila indicada
 // Retorno: apontador para o elemento removido, ou NULL se erro
 
-queue_t *queue_remove (queue_t **queue, queue_t *elem){
-    
-    if(queue == NULL){
-        fprintf(stderr, "Fila não existe\n");
-        return -1;
-    }
-
-    if(elem == NULL){
-        fprintf(stderr, "Elemento não existe\n");
-        return -2;
-    }
-    else{//verificar se elem está na fila
-
-        //ponteiro auxiliar recebe o primeiro elemento da fila
-        queue_t *aux = *queue;
-        //ponteiros auxiliares dos nós vizinhos ao elemento removido
-        queue_t *auxprev, *auxnext;
-
-        //verificando se o primeiro elemento da fila é igual a elem
-        if(aux == elem){
-            auxprev = elem->prev;
-            auxnext = elem->next;
-            auxprev->next = auxnext;
-            auxnext->prev = auxprev;
-
-            elem = NULL;
-
-            return 0;
-        }
-
-        //verificando as demais posições
-        while(aux->next != (*queue)){
-            if(aux == elem){
-                auxprev = elem->prev;
-                auxnext = elem->next;
-                auxprev->next = auxnext;
-                auxnext->prev = auxprev;
-
-                elem = NULL;
-
-                return 0;
-            }
-        }
-
-        //se o elem não foi encontrado, então ele está em outra fila
-        printf(stderr, "Elemento está em outra fila");
-        return -3;
-    }
-
-
+queue_t *queue_remove (queue_t **queue, queue_t *elem)
+{
+   dono_t *dono = NULL ;
+   int pertence, tamanho = -1, registra ;
+
+   if (queue == NULL || *queue == NULL || elem == NULL)
+   {
+      queueErro ("fila vazia ou inexistente, ou elemento inexistente") ;
+      return NULL ;
+   }
+
+   if (elem->next == NULL)
+   {
+      queueErro ("elemento nao esta em nenhuma fila") ;
+      return NULL ;
+   }
+
+   registra = donosEntra () ;
+   if (registra)
+      dono = donoBusca (elem) ;
+
+   // o primeiro elemento e o elemento registrado dispensam a busca na fila
+   if (elem == *queue)
+      pertence = 1 ;
+   else if (dono != NULL)
+      pertence = (dono->fila == queue) ;
+   else
+      pertence = filaContem (*queue, elem) ;
+
+#ifdef QUEUE_DEBUG
+   if (registra)
+   {
+      filaValida (queue) ;
+      if (pertence != filaContem (*queue, elem))
+         queueErro ("registro do dono diferente da fila") ;
+   }
+#endif
+
+   if (!pertence)
+   {
+      queueErro ("elemento esta em outra fila") ;
+      if (registra)
+         donosSai () ;
+      return NULL ;
+   }
+
+   if (registra)
+   {
+      if (elem != *queue)
+         tamanho = donoTamanho (queue) ;
+      else if (dono != NULL)
+         tamanho = dono->tamanho ;
+      if (dono != NULL)
+         donoRetira (dono) ;
+   }
+
+   if (elem->next == elem)
+      *queue = NULL ;
+   else
+   {
+      elem->prev->next = elem->next ;
+      elem->next->prev = elem->prev ;
+      if (*queue == elem)
+         *queue = elem->next ;
+   }
+   elem->prev = elem->next = NULL ;
+
+   if (registra)
+   {
+      // o tamanho passa para o novo primeiro elemento, se ele mudou
+      if (*queue != NULL)
+         donoAtualizaTamanho (queue, (tamanho < 0) ? -1 : tamanho - 1) ;
+      filaValida (queue) ;
+      donosSai () ;
+   }
+
+   return elem ;
 }
 
 //------------------------------------------------------------------------------
 // Conta o numero de elementos na fila
 // Retorno: numero de elementos na fila
 
-int queue_size (queue_t *queue) {
-
-    int i = 1;
-    //fila vazia 
-    if(queue == NULL)
-        return 0;
-    else{
-        //ponteiro auxiliar
-        queue_t *aux = queue;
-        //percorrendo a fila circular
-        while(aux->next != queue){
-            i++;
-            aux = queue->next;
-        }
-    }
-    return i;
+int queue_size (queue_t *queue)
+{
+   dono_t *dono = NULL ;
+   queue_t *aux ;
+   int n, registra ;
+
+   if (queue == NULL)
+      return 0 ;
+
+   registra = donosEntra () ;
+
+   // o tamanho registrado só vale se o registro ainda é o da fila que começa
+   // neste elemento
+   if (registra)
+   {
+      dono = donoBusca (queue) ;
+      if (dono != NULL && *dono->fila == queue && dono->tamanho >= 0)
+      {
+         n = dono->tamanho ;
+         donosSai () ;
+         return n ;
+      }
+   }
+
+   n = 0 ;
+   aux = queue ;
+   do
+   {
+      n++ ;
+      aux = aux->next ;
+   }
+   while (aux != queue) ;
+
+   // guarda o tamanho contado para as próximas consultas
+   if (registra)
+   {
+      if (dono != NULL && *dono->fila == queue)
+         dono->tamanho = n ;
+      donosSai () ;
+   }
+
+   return n ;
 }
 
 //------------------------------------------------------------------------------
@@ -154,21 +436,21 @@ int queue_size (queue_t *queue) {
 //
 // void print_elem (void *ptr) ; // ptr aponta para o elemento a imprimir
 
-void queue_print (char *name, queue_t *queue, void print_elem (void*) ){
-
-    if(queue == NULL)
-        printf("Fila Vazia");
-    else{
-        //ponteiro auxiliar
-        queue_t *aux = queue;
-
-        //imprimindo o primeiro da fila (em caso de fila com 1 elemento)
-        print_elem(aux);
-
-        //percorrendo a fila circular
-        while(aux->next != queue){
-            print_elem(aux);
-            aux = queue->next;
-        }
-    }
+void queue_print (char *name, queue_t *queue, void print_elem (void*) )
+{
+   queue_t *aux = queue ;
+
+   printf ("%s: [", name) ;
+   if (aux != NULL)
+   {
+      do
+      {
+         print_elem (aux) ;
+         aux = aux->next ;
+         if (aux != queue)
+            printf (" ") ;
+      }
+      while (aux != queue) ;
+   }
+   printf ("]\n") ;
 }
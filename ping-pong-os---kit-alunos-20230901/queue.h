@@ -55,4 +55,20 @@ int queue_size (queue_t *queue) ;
 
 void queue_print (char *name, queue_t *queue, void print_elem (void*) ) ;
 
+//------------------------------------------------------------------------------
+// Versões tipadas das operações, para filas de estruturas que começam com
+// prev e next (como task_t): dispensam os casts, e o compilador avisa se o
+// elemento não é do tipo da fila. QUEUE_REMOVE devolve o elemento no seu
+// próprio tipo.
+
+#define QUEUE_APPEND(queue, elem) \
+   ((void) sizeof (*(queue) == (elem)), \
+    queue_append ((queue_t **) (queue), (queue_t *) (elem)))
+
+#define QUEUE_REMOVE(queue, elem) \
+   ((void) sizeof (*(queue) == (elem)), \
+    (__typeof__ (elem)) queue_remove ((queue_t **) (queue), (queue_t *) (elem)))
+
+#define QUEUE_SIZE(queue) queue_size ((queue_t *) (queue))
+
 #endif